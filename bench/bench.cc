@@ -0,0 +1,369 @@
+/*
+ * Parse throughput and startup benchmarks.
+ *
+ * Synthetic schemas of 10 to 10k options are matched against argument
+ * vectors of 10 to 1M tokens that mix long ("--opt-1 v", "--opt-1=v"),
+ * short ("-a v", "-av", "-b") and positional forms. getopt_long(3) parses
+ * the same vectors as a baseline. One JSON object is printed per line.
+ */
+
+#include <argparse.h>
+
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace hgl::ap;
+
+static std::size_t alloc_count = 0;
+
+void * operator new(std::size_t size)
+{
+    ++alloc_count;
+    if (void * p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+/// option that can be given any number of times
+struct SinkOption: Option
+{
+    std::string_view value;
+
+    SinkOption(char short_option, std::string_view long_option):
+        Option(short_option, long_option, false, 1) {}
+
+protected:
+    virtual void accept(std::string_view text) override { this->value = text; }
+};
+
+/// text argument that takes all positional arguments
+struct SinkArg: TextArg
+{
+    using TextArg::TextArg;
+
+protected:
+    virtual void accept(std::string_view text) override { this->text = text; }
+};
+
+/// option set of the synthetic schema
+struct Schema
+{
+    struct Item
+    {
+        std::string long_opt;
+        char short_opt;
+        bool has_arg;
+    };
+
+    std::vector<Item> items;
+
+    explicit Schema(std::size_t n_opts)
+    {
+        static constexpr char short_chars[] =
+            "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+        items.reserve(n_opts);
+        for (std::size_t i = 0; i < n_opts; i++)
+        {
+            const bool has_arg = i % 4 != 3;
+            items.push_back({
+                (has_arg ? "opt-" : "flag-") + std::to_string(i),
+                i < sizeof short_chars - 1 ? short_chars[i] : Option::no_short_option,
+                has_arg,
+            });
+        }
+    }
+};
+
+/// acceptors built from a schema
+struct Acceptors
+{
+    std::vector<SinkOption> options;
+    std::vector<FlagOption> flags;
+    SinkArg rest{"rest", false};
+    std::vector<ArgumentAcceptor *> pointers;
+
+    explicit Acceptors(const Schema & schema)
+    {
+        options.reserve(schema.items.size());
+        flags.reserve(schema.items.size());
+
+        for (const auto & item : schema.items)
+        {
+            if (item.has_arg)
+            {
+                options.emplace_back(item.short_opt, item.long_opt);
+                pointers.push_back(&options.back());
+            }
+            else
+            {
+                flags.emplace_back(item.short_opt, item.long_opt, false);
+                pointers.push_back(&flags.back());
+            }
+        }
+
+        pointers.push_back(&rest);
+    }
+};
+
+/// generate an argument vector of exactly `n_tokens` tokens (program name excluded)
+static std::vector<std::string> make_args(const Schema & schema, std::size_t n_tokens)
+{
+    std::uint64_t seed = 0x9e3779b97f4a7c15u;
+    auto rand = [&seed] {
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+        return seed;
+    };
+
+    std::vector<std::string> args;
+    args.reserve(n_tokens + 1);
+    args.emplace_back("bench");
+
+    while (args.size() <= n_tokens)
+    {
+        const auto & item = schema.items[rand() % schema.items.size()];
+        const auto value = "v" + std::to_string(rand() % 1000);
+        const bool room = args.size() < n_tokens;
+
+        switch (rand() % 5)
+        {
+        case 0: // --opt v
+            if (item.has_arg && room)
+            {
+                args.push_back("--" + item.long_opt);
+                args.push_back(value);
+                continue;
+            }
+            break;
+
+        case 1: // --opt=v
+            if (item.has_arg)
+            {
+                args.push_back("--" + item.long_opt + '=' + value);
+                continue;
+            }
+            break;
+
+        case 2: // -a v, -av
+            if (item.short_opt != Option::no_short_option && item.has_arg)
+            {
+                if (room && rand() % 2)
+                {
+                    args.push_back(std::string{'-', item.short_opt});
+                    args.push_back(value);
+                }
+                else
+                {
+                    args.push_back(std::string{'-', item.short_opt} + value);
+                }
+                continue;
+            }
+            break;
+
+        case 3: // --flag, -b
+            if (!item.has_arg)
+            {
+                if (item.short_opt != Option::no_short_option && rand() % 2)
+                    args.push_back(std::string{'-', item.short_opt});
+                else
+                    args.push_back("--" + item.long_opt);
+                continue;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        args.push_back(value); // positional
+    }
+
+    return args;
+}
+
+static long peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+using Clock = std::chrono::steady_clock;
+
+/// run `fn` until `min_time` seconds elapsed (at least once), return ns per run
+template <typename Fn>
+static double measure(double min_time, std::size_t & runs, std::size_t & allocs, Fn && fn)
+{
+    runs = 0;
+    alloc_count = 0;
+
+    const auto start = Clock::now();
+    std::chrono::duration<double> elapsed{};
+    do
+    {
+        fn();
+        ++runs;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < min_time);
+
+    allocs = alloc_count;
+    return elapsed.count() * 1e9 / runs;
+}
+
+static void report(const char * bench, const char * parser, std::size_t n_opts,
+    std::size_t n_tokens, std::size_t runs, double ns, std::size_t allocs)
+{
+    std::printf("{\"bench\":\"%s\",\"parser\":\"%s\",\"options\":%zu,\"tokens\":%zu,"
+        "\"runs\":%zu,\"ns\":%.1f,\"ns_per_token\":%.3f,\"allocs_per_run\":%.1f,"
+        "\"peak_rss_kb\":%ld}\n",
+        bench, parser, n_opts, n_tokens, runs, ns,
+        n_tokens ? ns / n_tokens : 0.0, static_cast<double>(allocs) / runs,
+        peak_rss_kb());
+    std::fflush(stdout);
+}
+
+static void bench_startup(const Schema & schema, const Acceptors & acceptors, double min_time)
+{
+    std::size_t runs, allocs;
+    const auto & p = acceptors.pointers;
+
+    const auto ns = measure(min_time, runs, allocs, [&] {
+        ArgumentParser parser(p.data(), p.data() + p.size());
+    });
+
+    report("startup", "hgargparse", schema.items.size(), 0, runs, ns, allocs);
+}
+
+static void bench_parse(const Schema & schema, Acceptors & acceptors,
+    const std::vector<std::string> & args, double min_time)
+{
+    std::vector<const char *> argv;
+    argv.reserve(args.size());
+    for (const auto & s : args)
+        argv.push_back(s.c_str());
+
+    const auto & p = acceptors.pointers;
+    ArgumentParser parser(p.data(), p.data() + p.size());
+
+    std::size_t runs, allocs;
+    const auto ns = measure(min_time, runs, allocs, [&] {
+        parser(static_cast<int>(argv.size()), argv.data());
+    });
+
+    report("parse", "hgargparse", schema.items.size(), args.size() - 1, runs, ns, allocs);
+}
+
+static void bench_getopt(const Schema & schema,
+    const std::vector<std::string> & args, double min_time)
+{
+    std::string optstring = "-"; // return positional arguments in order
+    std::vector<struct option> longopts;
+    longopts.reserve(schema.items.size() + 1);
+
+    for (std::size_t i = 0; i < schema.items.size(); i++)
+    {
+        const auto & item = schema.items[i];
+        longopts.push_back({item.long_opt.c_str(),
+            item.has_arg ? required_argument : no_argument, nullptr, 256 + int(i)});
+        if (item.short_opt != Option::no_short_option)
+        {
+            optstring += item.short_opt;
+            if (item.has_arg)
+                optstring += ':';
+        }
+    }
+    longopts.push_back({nullptr, 0, nullptr, 0});
+
+    std::vector<char *> argv_src, argv;
+    argv_src.reserve(args.size());
+    for (const auto & s : args)
+        argv_src.push_back(const_cast<char *>(s.c_str()));
+    argv.resize(argv_src.size());
+
+    opterr = 0;
+    volatile long sink = 0;
+
+    std::size_t runs, allocs;
+    const auto ns = measure(min_time, runs, allocs, [&] {
+        argv.assign(argv_src.begin(), argv_src.end());
+        optind = 0;
+        int c, idx;
+        while ((c = getopt_long(int(argv.size()), argv.data(),
+                optstring.c_str(), longopts.data(), &idx)) != -1)
+            sink = sink + c;
+    });
+
+    report("parse", "getopt_long", schema.items.size(), args.size() - 1, runs, ns, allocs);
+}
+
+int main(int argc, const char * argv[])
+{
+    SpecialOption o_help('h', "help", "print help and exit");
+    IntOption o_max_opts('o', "max-options", false, "largest schema size (10000)");
+    IntOption o_max_tokens('t', "max-tokens", false, "largest argument count (1000000)");
+    FloatOption o_min_time(FloatOption::no_short_option, "min-time", false,
+        "minimum seconds per case (0.2)");
+    IntOption o_getopt_limit(IntOption::no_short_option, "getopt-limit", false,
+        "skip getopt_long when options * tokens exceeds it (100000000)");
+
+    o_max_opts.value = 10000;
+    o_max_tokens.value = 1000000;
+    o_min_time.value = 0.2;
+    o_getopt_limit.value = 100000000;
+
+    ArgumentParser parser({&o_help, &o_max_opts, &o_max_tokens, &o_min_time, &o_getopt_limit});
+
+    try
+    {
+        parser(argc, argv);
+    }
+    catch (const SpecialOption * p)
+    {
+        parser.print_help(std::cout);
+        return 0;
+    }
+    catch (const std::exception & e)
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+
+    for (std::size_t n_opts = 10; n_opts <= std::size_t(o_max_opts.value); n_opts *= 10)
+    {
+        const Schema schema(n_opts);
+        Acceptors acceptors(schema);
+
+        bench_startup(schema, acceptors, o_min_time.value);
+
+        for (std::size_t n_tokens = 10; n_tokens <= std::size_t(o_max_tokens.value); n_tokens *= 10)
+        {
+            const auto args = make_args(schema, n_tokens);
+
+            bench_parse(schema, acceptors, args, o_min_time.value);
+
+            if (n_opts * n_tokens <= std::size_t(o_getopt_limit.value))
+                bench_getopt(schema, args, o_min_time.value);
+        }
+    }
+
+    return 0;
+}
@@ -5,30 +5,148 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
 #include <initializer_list>
+#include <mutex>
 #include <ostream>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#if __has_include(<version>)
+#   include <version>
+#endif
+#ifdef __cpp_lib_span
+#   include <span>
+#endif
 
 namespace hgl::ap
 {
-    /// parse error
-    class ArgumentParseError: public std::exception
+#ifdef __cpp_lib_span
+    template <typename T> using Span = std::span<T>;
+#else
+    /// view of a contiguous sequence of objects
+    template <typename T> class Span
     {
     private:
-        std::string msg;
+        T         * ptr;
+        std::size_t len;
 
     public:
-        ArgumentParseError() = default;
-        ArgumentParseError(const char * msg): msg(msg) { }
-        ArgumentParseError(const std::string & msg): msg(msg) { }
-        ArgumentParseError(std::string && msg): msg(std::move(msg)) { }
+        constexpr Span() noexcept: ptr(nullptr), len(0) {}
+        constexpr Span(T * first, std::size_t count) noexcept: ptr(first), len(count) {}
+        constexpr Span(T * first, T * last) noexcept: ptr(first), len(last - first) {}
+        template <typename C> constexpr Span(C & c) noexcept: ptr(c.data()), len(c.size()) {}
+
+        constexpr T * data() const noexcept { return ptr; }
+        constexpr std::size_t size() const noexcept { return len; }
+        constexpr bool empty() const noexcept { return len == 0; }
+        constexpr T * begin() const noexcept { return ptr; }
+        constexpr T * end() const noexcept { return ptr + len; }
+        constexpr T & operator[](std::size_t i) const noexcept { return ptr[i]; }
+    };
+#endif
+
+    /// file mapped into memory privately, for in-place reading and modification
+    class MappedFile
+    {
+    private:
+        char        * addr;
+        std::size_t   length;
+
+    public:
+        MappedFile() noexcept: addr(nullptr), length(0) {}
+        MappedFile(const MappedFile &) = delete;
+        MappedFile(MappedFile && other) noexcept;
+        ~MappedFile();
+
+        MappedFile & operator=(const MappedFile &) = delete;
+        MappedFile & operator=(MappedFile && other) noexcept;
+
+        /**
+         * @brief map a file, replacing current mapping
+         *
+         * Files that cannot be mapped, such as pipes, are read instead.
+         *
+         * @param path file path
+         * @return false if the file cannot be mapped (errno is set)
+         *
+         * @note one more byte, initialized to '\0', is always mapped after
+         *  the end of file
+         */
+        bool open(const char * path) noexcept;
+        /// unmap the file
+        void close() noexcept;
 
-        const char * what() const noexcept override { return msg.c_str(); }
+        char * data() const noexcept { return addr; }
+        std::size_t size() const noexcept { return length; }
     };
 
+    /// bump allocator; memory is released all at once
+    class Arena
+    {
+    private:
+        struct alignas(std::max_align_t) Block
+        {
+            Block     * next;
+            std::size_t size; ///< bytes of data after the header
+        };
+
+        Block * blocks = nullptr; ///< newest (and largest) block first
+        char  * cur = nullptr;
+        char  * end = nullptr;
+
+    public:
+        Arena() noexcept = default;
+        Arena(const Arena &) = delete;
+        ~Arena();
+
+        Arena & operator=(const Arena &) = delete;
+
+        /**
+         * @brief allocate uninitialized memory
+         *
+         * @param size number of bytes
+         * @param align alignment, a power of 2 not greater than that of `std::max_align_t`
+         */
+        void * allocate(std::size_t size, std::size_t align);
+        /**
+         * @brief enlarge an allocation, in place if it is the latest one
+         *
+         * @param p memory from allocate() or grow()
+         * @param old_size current size of `p`
+         * @param new_size new size, not less than `old_size`
+         * @param align alignment given to allocate()
+         * @return the enlarged memory, which has the bytes of `p`
+         */
+        void * grow(void * p, std::size_t old_size, std::size_t new_size, std::size_t align);
+        /// release all memory allocated, keeping the largest block for reuse
+        void reset() noexcept;
+    };
+
+    /// option names reported by an acceptor, used to build parser index
+    struct AcceptorInfo
+    {
+        std::string_view long_opt; ///< long option name, or empty
+        char short_opt = '\0';     ///< short option name, or '\0'
+        bool negatable = false;    ///< whether "no-" + long_opt is accepted too
+        bool repeatable = false;   ///< whether it can be given more than once
+        bool special = false;      ///< whether parsing stops once it is accepted
+        bool env = false;          ///< whether it can be given by an environment variable
+        int  n_args = 0;           ///< number of arguments to consume
+        std::string_view env_var;  ///< environment variable name; derived from get_name() if empty
+        Span<const std::string_view> choices; ///< values offered by completion; empty if not listed
+    };
+
+    template <typename... Opts> class StaticArgumentParser;
+
     /// arguments acceptor
     class ArgumentAcceptor
     {
@@ -107,12 +225,66 @@ namespace hgl::ap
             bool required,  std::uint8_t _u8 = 0, std::uint16_t _u16 = 0):
             completed(completed), accepting_longopt(accepting_longopt),
             accepting_shortopt(accepting_shortop), accepting_restarg(accepting_restarg),
-            required(required), _u8(_u8), _u16(_u16) {}
+            required(required), _bit_0(false), _bit_1(false), _bit_2(false),
+            _u8(_u8), _u16(_u16) {}
+
+        /**
+         * @brief report option names for the parser lookup index
+         *
+         * @param[out] info option names
+         * @return false if names cannot be listed, acceptable() will be probed
+         *
+         * @note override it to return false if acceptable() is overridden
+         *  to match names other than the reported ones
+         */
+        virtual bool get_info(AcceptorInfo & info) const noexcept;
+
+        /**
+         * @brief prepare for a parse by ArgumentParser
+         *
+         * @param arena storage that lives until the next parse
+         */
+        virtual void begin_parse(Arena & arena) noexcept;
+        /**
+         * @brief check accepted values that have not been converted yet
+         *
+         * @throw ArgumentParseError if a value is invalid
+         *
+         * @see ArgumentParser::validate()
+         */
+        virtual void validate() const;
+        /**
+         * @brief check a text as accept(std::string_view) would convert it, keeping nothing
+         *
+         * @param text text from command line args, environment or config file
+         *
+         * @throw ArgumentParseError if the text is invalid
+         *
+         * @see ArgumentSchema::parse()
+         */
+        virtual void check(std::string_view text) const;
 
         virtual void print_useage(std::ostream & out) const noexcept = 0;
         virtual void print_helpinfo(std::ostream & out) const noexcept = 0;
 
+        /**
+         * @brief append usage text, e.g. "[-f NAME]"
+         *
+         * @note the text printed by print_useage() is used by default
+         */
+        virtual void format_usage(std::string & out) const;
+        /**
+         * @brief get help line, which is laid out in two columns by the parser
+         *
+         * @param[out] names left column, e.g. "-f NAME, --file NAME"; empty for no line
+         * @param[out] help right column
+         * @return false to use the text printed by print_helpinfo() instead
+         */
+        virtual bool get_helpinfo(std::string & names, std::string_view & help) const;
+
+        friend class ArgumentSchema;
         friend class ArgumentParser;
+        template <typename... Opts> friend class StaticArgumentParser;
 
     public:
         /**
@@ -123,36 +295,766 @@ namespace hgl::ap
         virtual void get_name(std::string & name) const noexcept = 0;
     };
 
-    /// argument parser
-    class ArgumentParser
+    /// command line arguments, as given to `main()`
+    struct ArgVector
+    {
+        int           argc;
+        const char ** argv;
+    };
+
+    class ArgumentSchema;
+    class ArgumentParser;
+
+    /// shells for which ArgumentSchema::print_completion_script() writes a script
+    enum class CompletionShell : std::uint8_t
+    {
+        bash,
+        zsh,
+        fish,
+    };
+
+    /// where an argument comes from
+    enum class ArgSource : std::uint8_t
+    {
+        command_line,
+        response_file,
+        environment,
+        config_file,
+    };
+
+    /// syntactic kind of a command line token
+    enum class TokenKind : std::uint8_t
+    {
+        positional,  ///< e.g. "file", ""
+        long_option, ///< e.g. "--name", "--name=value"
+        short_options, ///< e.g. "-f", "-fvalue", "-abc"
+        dash,        ///< "-"
+        terminator,  ///< "--"
+    };
+
+    /// a command line token, measured once before parsing
+    struct TokenInfo
+    {
+        std::uint32_t length;    ///< bytes before the terminating '\0'
+        std::uint32_t equal_pos; ///< offset of the first '=', or length if none
+        TokenKind     kind;
+    };
+
+    /// why a parse stopped
+    enum class ParseErrorCode : std::uint8_t
+    {
+        ok,
+        special,             ///< a special option (e.g. "--help") stopped parsing; not an error
+        unknown_option,
+        duplicated_option,   ///< option given again but it accepts only once
+        unexpected_argument, ///< text argument that no acceptor takes
+        unexpected_value,    ///< value given to an option that takes no argument
+        value_count,         ///< attached value given to an option that takes many arguments
+        too_few_arguments,
+        missing_required,
+        bad_response_file,   ///< response file cannot be read
+        response_file_depth, ///< response files nested too deeply
+        bad_config_file,     ///< config file cannot be read
+        bad_config_line,     ///< config file line is not "key = value" or "[section]"
+        unknown_config_key,  ///< config file key matches no option
+        unknown_subcommand,  ///< text argument that is neither a subcommand nor taken by an acceptor
+        ambiguous_option,    ///< abbreviated long option that matches many options
+        bad_arguments,       ///< arguments that an acceptor does not take
+        bad_value,           ///< value that is not a valid literal of its type
+        value_out_of_range,  ///< literal beyond the range of its type, or range of too many values
+        bad_choice,          ///< value that is none of the choices of an option
+        other,               ///< error described only by its message
+        bad_subcommand,      ///< parser of a subcommand cannot be created
+        unclosed_quote,      ///< quote not closed in a response file
+        out_of_memory,       ///< storage of the parse cannot be allocated
+    };
+
+    /// outcome of a parse, cheap to return and to copy
+    struct ParseStatus
+    {
+        ParseErrorCode           code = ParseErrorCode::ok;
+        std::int32_t             detail = 0;         ///< errno, line number, number of arguments the option takes, or of matched or missing acceptors
+        std::size_t              token = 0;          ///< index of the failing token in the parsed args
+        const ArgumentAcceptor * acceptor = nullptr; ///< the (first) acceptor involved, if any
+        std::string_view         text;               ///< option name, argument, response file path, or names of missing acceptors
+
+        /// whether parsing succeeded (a special option is not an error)
+        bool ok() const noexcept { return code <= ParseErrorCode::special; }
+
+        /**
+         * @brief format a human readable error message
+         *
+         * @param args the parsed arguments, to quote the failing token
+         * @return the message; empty if ok()
+         */
+        std::string message(Span<const char * const> args) const;
+    };
+
+    /**
+     * @brief parse error
+     *
+     * It carries what went wrong as data, and formats the message only when
+     * what() is first called. Texts in it are views of the parsed arguments,
+     * or of the text given to a conversion function, and acceptors are
+     * referred to by pointer; they have to live until what() is called.
+     */
+    class ArgumentParseError: public std::exception
+    {
+    private:
+        ParseStatus                  parse_status{ParseErrorCode::other, 0, 0, nullptr, {}};
+        std::string_view             token_text; ///< the failing token, quoted by the message
+        const char                 * reason = nullptr; ///< e.g. "not a valid int literal: "
+        Span<const char * const>     args;       ///< arguments not taken, for ParseErrorCode::bad_arguments
+        Span<const std::string_view> choices;    ///< for ParseErrorCode::bad_choice
+        mutable std::string          msg;        ///< formatted by what()
+
+        /// record where the error occurred, if the thrower did not know
+        void locate(std::size_t token, const ArgumentAcceptor * acceptor) noexcept
+        {
+            this->parse_status.token = token;
+            if (this->parse_status.acceptor == nullptr)
+                this->parse_status.acceptor = acceptor;
+        }
+
+        friend class ArgumentSchema;
+        template <typename... Opts> friend class StaticArgumentParser;
+
+    public:
+        ArgumentParseError() = default;
+        ArgumentParseError(const char * msg): msg(msg) { }
+        ArgumentParseError(const std::string & msg): msg(msg) { }
+        ArgumentParseError(std::string && msg): msg(std::move(msg)) { }
+
+        /**
+         * @brief error of a parse
+         *
+         * @param status failed status
+         * @param args the parsed arguments, of which the failing token is quoted
+         */
+        ArgumentParseError(const ParseStatus & status, Span<const char * const> args) noexcept:
+            parse_status(status), token_text(status.token < args.size() ? args[status.token] : "") { }
+
+        /**
+         * @brief error of converting a text
+         *
+         * @param code ParseErrorCode::bad_value or ParseErrorCode::value_out_of_range
+         * @param reason static text that the message starts with
+         */
+        ArgumentParseError(ParseErrorCode code, const char * reason, std::string_view text,
+            const ArgumentAcceptor * acceptor = nullptr) noexcept:
+            parse_status{code, 0, 0, acceptor, text}, reason(reason) { }
+
+        /// error of a text that is none of `choices`
+        ArgumentParseError(std::string_view text, Span<const std::string_view> choices,
+            const ArgumentAcceptor * acceptor = nullptr) noexcept:
+            parse_status{ParseErrorCode::bad_choice, 0, 0, acceptor, text}, choices(choices) { }
+
+        /**
+         * @brief error of `n` arguments that `acceptor` does not take
+         *
+         * @param text the argument if `n` is 1
+         * @param args the arguments if `n` is more than 1
+         */
+        ArgumentParseError(const ArgumentAcceptor * acceptor, int n, std::string_view text,
+            Span<const char * const> args = {}) noexcept:
+            parse_status{ParseErrorCode::bad_arguments, n, 0, acceptor, text}, args(args) { }
+
+        /// what went wrong; `token` is only known for errors thrown by parsers
+        const ParseStatus & status() const noexcept { return parse_status; }
+        ParseErrorCode code() const noexcept { return parse_status.code; }
+
+        const char * what() const noexcept override;
+    };
+
+#ifdef HGL_AP_INSTRUMENT
+    /// phase of a parse, timed by ParseProfile
+    enum class ParsePhase : std::uint8_t
+    {
+        parse,    ///< a whole parse, less its phases
+        tokenize, ///< expansion of response files and set-up of acceptors
+        match,    ///< matching of tokens, environment variables and config lines
+        convert,  ///< ArgumentAcceptor::accept() calls, which convert values
+        required, ///< check of required acceptors
+        format,   ///< formatting of error messages
+    };
+
+    /**
+     * @brief counters and phase timers of the parses on a thread
+     *
+     * Only available if the library is built with HGL_AP_INSTRUMENT defined
+     * (CMake option INSTRUMENT); otherwise the hooks compile to nothing.
+     * A profile collects from the threads it is attached to, one at a time.
+     * Phase times are self times: time spent in a nested phase (e.g.
+     * converting a value while matching) counts only for the nested phase.
+     */
+    class ParseProfile
     {
+    public:
+        static constexpr std::size_t n_phases = 6;
+
+        /// what happened to an acceptor
+        struct Counters
+        {
+            std::uint64_t lookups = 0;     ///< index lookups that found it
+            std::uint64_t probes = 0;      ///< ArgumentAcceptor::acceptable() calls
+            std::uint64_t calls = 0;       ///< virtual calls, including probes and conversions
+            std::uint64_t conversions = 0; ///< ArgumentAcceptor::accept() calls
+            std::uint64_t allocations = 0; ///< arena allocations
+            std::uint64_t convert_ns = 0;  ///< time spent in conversions
+        };
+
+        struct AcceptorStats
+        {
+            const ArgumentAcceptor * acceptor; ///< nullptr for lookups that found nothing
+            std::string              name;
+            Counters                 counters;
+        };
+
+        /// a timed phase, as in a trace
+        struct Event
+        {
+            ParsePhase    phase;
+            std::uint32_t depth;       ///< nesting level
+            std::uint64_t begin_ns;    ///< since the profile was created or cleared
+            std::uint64_t duration_ns; ///< including nested phases
+        };
+
+        /// called after each outermost parse
+        using Callback = void (*)(const ParseProfile & profile, void * context);
+
     private:
-        struct ArgAcceptorArray
+        struct Frame
         {
-            using value_type = ArgumentAcceptor * const;
-            value_type * p_beg, * p_end;
-            auto begin() const noexcept { return p_beg; }
-            auto end() const noexcept { return p_end; }
+            ParsePhase               phase;
+            const ArgumentAcceptor * acceptor;
+            std::uint64_t            begin_ns;
+            std::uint64_t            resumed_ns; ///< start of current self time
         };
 
-        std::string_view prog_name;
-        ArgAcceptorArray acceptors;
+        std::uint64_t origin_ns;
+        std::uint64_t n_parses = 0;
+        std::uint64_t phase_time[n_phases] = {};
+        std::vector<AcceptorStats> stats;
+        std::unordered_map<const ArgumentAcceptor*, std::size_t> stats_index;
+        std::vector<Event> event_list;
+        std::vector<Frame> frames;
+        Callback callback = nullptr;
+        void * callback_context = nullptr;
+
+        Counters & counters(const ArgumentAcceptor * aa);
+        void enter(ParsePhase phase, const ArgumentAcceptor * aa);
+        void leave();
+
+        friend class _ProfileScope;
+
+    public:
+        std::size_t max_events = std::size_t(1) << 20; ///< events beyond it are dropped, but still timed
+
+        ParseProfile();
+
+        /// attach a profile to the calling thread; nullptr to detach
+        static void attach(ParseProfile * profile) noexcept;
+        /// profile attached to the calling thread, or nullptr
+        static ParseProfile * current() noexcept;
+
+        /// set function to call after each outermost parse; nullptr to call none
+        void set_callback(Callback callback, void * context = nullptr) noexcept;
+        /// drop all data
+        void clear() noexcept;
+
+        /// number of outermost parses
+        std::uint64_t parses() const noexcept { return n_parses; }
+        /// self time of a phase in all parses
+        std::uint64_t phase_ns(ParsePhase phase) const noexcept
+        { return phase_time[static_cast<std::size_t>(phase)]; }
+        /// counters of acceptors, in order of first use
+        Span<const AcceptorStats> acceptors() const noexcept { return stats; }
+        /// counters of an acceptor, or nullptr if unused
+        const Counters * find(const ArgumentAcceptor & aa) const noexcept;
+        /// timed phases, in order of end
+        Span<const Event> events() const noexcept { return event_list; }
+
+        /**
+         * @brief write events and counters as Chrome trace JSON
+         *
+         * The output loads in chrome://tracing or Perfetto. Conversions are
+         * not written as events, but as counters of the acceptors.
+         *
+         * @return false if writing fails
+         */
+        bool write_chrome_trace(std::ostream & out) const;
+        /// @see write_chrome_trace(std::ostream & out) const
+        bool write_chrome_trace(const char * path) const;
+    };
+#endif
+
+    /// result of ArgumentSchema::parse(), stored apart from the acceptors
+    class ParseResult
+    {
+    public:
+        /// an accepted option or text argument
+        struct Occurrence
+        {
+            ArgumentAcceptor   * acceptor;
+            std::size_t          token;  ///< index of the token; number of tokens if not from them
+            std::string_view     name;   ///< option name as given; empty for text argument
+            std::string_view     value;  ///< the first argument
+            const char * const * args;   ///< arguments in args(); nullptr if attached to name
+            int                  n_args; ///< number of arguments
+            ArgSource            source; ///< where the token comes from
+        };
+
+    private:
+        static constexpr std::uint32_t no_occurrence = UINT32_MAX;
+
+        const ArgumentSchema * schema = nullptr;
+        std::vector<Occurrence> occurrence_list;
+        std::vector<std::uint8_t> state;        ///< per acceptor parse state
+        std::vector<std::uint32_t> last;        ///< per acceptor last occurrence index
+        std::vector<std::uint64_t> present;     ///< per acceptor presence bits
+        std::list<MappedFile> response_files;
+        std::vector<const char*> expanded_args;
+        std::vector<ArgSource> expanded_sources;
+        std::vector<TokenInfo> token_info; ///< per parsed arg
+        MappedFile config;
+        std::size_t n_args = 0;
+        const char * const * arg_vec = nullptr;
+        std::string_view cmdline; ///< parsed blob, if not parsed from an argument vector
+        std::string_view prog;
+        const ArgumentAcceptor * special_acceptor = nullptr;
+        ParseStatus parse_status;
+        ArgumentParseError value_error; ///< error of a value that cannot be converted, for its message
+        std::unique_ptr<std::string> missing_names; ///< names of missing required acceptors, kept when moved
+        std::string_view command; ///< selected subcommand
+        std::unique_ptr<ParseResult> command_result;
+
+        void clear() noexcept;
+        void reset(const ArgumentSchema & schema);
+
+        friend class ArgumentSchema;
+
+    public:
+        /// whether parsing succeeded
+        bool ok() const noexcept { return parse_status.ok(); }
+        /// how parsing ended
+        const ParseStatus & status() const noexcept { return parse_status; }
+        /// error message if parsing failed, formatted on demand
+        std::string error() const;
+        /// program name (from argv[0])
+        std::string_view prog_name() const noexcept { return prog; }
+        /// the special option that stopped parsing, if any (e.g. "--help")
+        const ArgumentAcceptor * special() const noexcept { return special_acceptor; }
+        /// parsed arguments, including those from response files; empty if a blob is parsed
+        Span<const char * const> args() const noexcept { return {arg_vec, n_args}; }
+        /// all occurrences in order
+        Span<const Occurrence> occurrences() const noexcept { return occurrence_list; }
+        /// name of the selected subcommand, or empty
+        std::string_view subcommand() const noexcept { return command; }
+        /// result of the selected subcommand, or nullptr
+        const ParseResult * subcommand_result() const noexcept
+        { return command.empty() ? nullptr : command_result.get(); }
+
+        /// find last occurrence of an acceptor
+        const Occurrence * find(const ArgumentAcceptor & aa) const noexcept;
+        /// whether an acceptor has accepted anything
+        bool has(const ArgumentAcceptor & aa) const noexcept;
+
+        /**
+         * @brief get value of an option from its last occurrence
+         *
+         * @param opt the option, which provides `value_type` and `decode()`
+         * @param default_value value to return if the option is not present
+         *
+         * @throw ArgumentParseError if the text cannot be converted
+         */
+        template <typename Opt> typename Opt::value_type
+        value(const Opt & opt, typename Opt::value_type default_value = {}) const
+        {
+            const Occurrence * const occ = this->find(opt);
+            return occ ? opt.decode(*occ) : default_value;
+        }
+    };
+
+    /**
+     * @brief compiled set of acceptors
+     *
+     * A schema indexes the acceptors once. It is read-only after construction,
+     * so that one schema can be shared by threads and used for any number of
+     * parses, whose results are stored in ParseResult objects.
+     */
+    class ArgumentSchema
+    {
+    protected:
+        std::vector<ArgumentAcceptor*> acceptors;
+        std::vector<std::uint8_t> initial_state; ///< per acceptor parse state
+        std::vector<std::uint64_t> required_mask; ///< per acceptor bits, set if required
+
+        struct ShortOptEntry
+        {
+            std::uint32_t slot = UINT32_MAX; ///< UINT32_MAX if no acceptor
+            int n_args = 0;
+        };
+
+        /**
+         * @brief long option names in parallel arrays
+         *
+         * Names are copied back to back into one pool and found by open
+         * addressing over (hash, name) buckets, so that a lookup reads a few
+         * buckets and one name instead of the acceptors, which are scattered
+         * in memory. The acceptor is only touched once its name matches.
+         */
+        struct LongNameTable
+        {
+            static constexpr std::uint32_t npos = UINT32_MAX;
+
+            struct Bucket
+            {
+                std::uint32_t hash;
+                std::uint32_t name; ///< name index + 1, or 0 if empty
+            };
+
+            std::string                pool;    ///< names, not NUL-terminated
+            std::vector<std::uint32_t> offsets; ///< per name, into pool
+            std::vector<std::uint32_t> lengths; ///< per name
+            std::vector<std::uint32_t> hashes;  ///< per name
+            std::vector<std::uint32_t> slots;   ///< per name, of the acceptor
+            std::vector<std::int32_t>  arities; ///< per name, arguments taken by the acceptor
+            std::vector<Bucket>        buckets; ///< size is 0 or a power of 2
+
+            std::uint32_t size() const noexcept { return std::uint32_t(this->slots.size()); }
+            std::string_view name(std::uint32_t i) const noexcept
+            { return {this->pool.data() + this->offsets[i], this->lengths[i]}; }
+
+            void clear() noexcept;
+            /// add a name unless present; the first acceptor of a name wins
+            void insert(std::string_view name, std::uint32_t slot, int n_args);
+            /// index of a name, or npos
+            std::uint32_t find(std::string_view name) const noexcept;
+
+        private:
+            void rehash(std::size_t n_buckets);
+        };
+
+        LongNameTable long_index;
+        ShortOptEntry short_index[256]; ///< dispatch table, by option byte
+        std::vector<std::uint32_t> unindexed; ///< acceptors to be probed
+        std::vector<int> restarg_arity; ///< per acceptor, acceptable(nullptr) when indexed
+        std::unordered_map<const ArgumentAcceptor*, std::uint32_t> slots;
+        std::list<std::string> name_pool; ///< storage of generated names
+        std::uint32_t generation = 0; ///< incremented when acceptors change
+
+        bool response_files_enabled = false;
+        bool abbreviations_enabled = false;
+
+        /// indexes into long_index in name order, for abbreviations and completion
+        std::vector<std::uint32_t> long_names;
+
+        struct EnvEntry
+        {
+            std::uint32_t    slot;
+            int              n_args;
+            std::string_view opt_name; ///< name given to the acceptor
+        };
+
+        std::unordered_map<std::string_view, EnvEntry> env_index; ///< by variable name
+        std::string env_prefix;
+
+        std::string config_path;
+        bool config_required = false;
+
+        struct Accepting; ///< parse mode that calls ArgumentAcceptor::accept()
+        struct Recording; ///< parse mode that records into a ParseResult
+        struct ArgvTokens; ///< tokens of an argument vector
+        struct BlobTokens; ///< tokens of a NUL-separated buffer
 
         void chech_health();
-        bool is_duplicated(int, std::string_view);
+        void build_index();
+        void build_long_names();
+        template <typename Mode> ArgumentAcceptor * match(
+            const Mode &, std::string_view & long_opt, int & n, std::uint32_t & slot) const;
+        std::size_t abbreviate(std::string_view prefix, std::uint32_t & name) const noexcept;
+        template <typename Mode> ArgumentAcceptor * match(
+            const Mode &, char short_opt, int & n, std::uint32_t & slot) const;
+        template <typename Mode, typename Name>
+        bool is_duplicated(const Mode &, std::uint32_t slot, Name optname) const;
+        template <typename Mode>
+        ParseStatus check_required(const Mode & mode, std::size_t token) const;
+        template <typename Mode, typename Tokens>
+        ParseStatus parse_args(Mode & mode, Tokens & tokens) const;
+        template <typename Mode>
+        ParseStatus parse_config(Mode & mode, MappedFile & file, std::size_t token) const;
+        /// @param sources sources of the tokens, if a parent parser expanded response files in them
+        template <typename Tokens>
+        ParseStatus parse_tokens(Tokens & tokens, ParseResult & result,
+            Span<const ArgSource> sources = {}) const noexcept;
+
+        using SubcommandFactory = std::unique_ptr<ArgumentParser> (*)();
+
+        struct Subcommand
+        {
+            std::string           name;
+            SubcommandFactory     factory;
+            const char          * help;
+            mutable std::once_flag built;
+            mutable std::unique_ptr<ArgumentParser> parser;
+        };
+
+        std::vector<std::unique_ptr<Subcommand>> subcommands; ///< sorted by name
+
+        const Subcommand * find_subcommand(std::string_view name) const noexcept;
+        ArgumentParser & subcommand_parser(const Subcommand & cmd) const;
+
+        void complete_words(Span<const char * const> words, std::ostream & out) const;
+
+        friend class ParseResult;
 
     public:
-        ArgumentParser() = default;
-        ArgumentParser(std::initializer_list<ArgumentAcceptor*> aas);
-        ArgumentParser(ArgumentAcceptor * const * aa_begin, ArgumentAcceptor * const * aa_end);
+        ArgumentSchema() = default;
+        ArgumentSchema(std::initializer_list<ArgumentAcceptor*> aas);
+        ArgumentSchema(ArgumentAcceptor * const * aa_begin, ArgumentAcceptor * const * aa_end);
+        /// subcommand parsers of derived types are deleted through ArgumentParser pointers
+        virtual ~ArgumentSchema() = default;
 
         /**
          * @brief re-assign acceptors array
          *
          * @param begin frist elem of the array of acceptors
          * @param end the one after last elem of the array of acceptors
+         *
+         * @note the acceptors shall not have been used by a parse
+         */
+        void set_acceptors(ArgumentAcceptor * const * begin, ArgumentAcceptor * const * end);
+
+        /**
+         * @brief enable or disable expansion of "@file" arguments
+         *
+         * An "@file" argument is replaced by the arguments read from the file,
+         * which are separated by white spaces and may be quoted with '' or ""
+         * or escaped with backslashes. Response files can be nested.
+         * Files are mapped into memory and split in place, so the texts
+         * given to acceptors point into the mappings, which stay valid until
+         * the next parse or the destruction of the parser (or the result).
+         *
+         * @param enabled whether to expand response files
+         */
+        void enable_response_files(bool enabled = true) noexcept;
+
+        /**
+         * @brief enable or disable abbreviated long options
+         *
+         * A long option may then be given by a prefix of its name that no
+         * other name starts with, e.g. "--verb" for "--verbose". An exact
+         * name always wins; a prefix of many names is reported as
+         * ParseErrorCode::ambiguous_option. Prefixes are resolved by a binary
+         * search over the sorted names of indexed acceptors (see
+         * ArgumentAcceptor::get_info()), built when enabled. Names in config
+         * files and environment variables are not abbreviated.
+         *
+         * @param enabled whether to accept abbreviations
+         */
+        void enable_abbreviations(bool enabled = true);
+
+        /**
+         * @brief set prefix of derived environment variable names
+         *
+         * An option that reads an environment variable without giving its
+         * name (see Option::set_env()) reads `prefix` + its name, e.g.
+         * "MYAPP_" + "OUTPUT_FILE" for "--output-file".
+         *
+         * @param prefix name prefix
+         */
+        void set_env_prefix(std::string_view prefix);
+
+        /**
+         * @brief read option values from a config file
+         *
+         * The file has "key = value" lines, where keys are long option names,
+         * and may have "[section]" lines, after which keys are prefixed with
+         * "section-". Values may be quoted with '' or "". Lines beginning
+         * with '#' or ';' are comments. For an option that takes no
+         * argument, the values "", "0", "false", "no" and "off" count as not
+         * given. Options taking more than one argument cannot be set.
+         *
+         * Values in the file have the lowest precedence: an option given in
+         * arguments or in an environment variable (see Option::set_env())
+         * ignores the file. A later line overrides an earlier one with the
+         * same key, for list options too, and a false value for a flag
+         * unsets it. The file is mapped and split in place on each parse,
+         * and values are views into the mapping, which stays valid until
+         * the next parse.
+         *
+         * @param path file path; empty to read no file
+         * @param required whether a missing file is an error
+         */
+        void set_config_file(std::string_view path, bool required = true);
+
+        /**
+         * @brief add a subcommand, e.g. "build" in "tool build -j 4"
+         *
+         * The first text argument that names a subcommand ends the arguments
+         * of this schema; the rest are parsed by the subcommand's parser,
+         * with the command name as program name. The parser, and thus its
+         * acceptors, is only created by `factory` when the subcommand is
+         * first selected, and is kept for later parses.
+         *
+         * @param name subcommand name
+         * @param factory function to create the parser of the subcommand
+         * @param help help infomation
+         *
+         * @throw std::invalid_argument if the name is empty or already used
+         */
+        void add_subcommand(std::string_view name, SubcommandFactory factory,
+            const char * help = nullptr);
+        /// add a subcommand whose parser is a default-constructed `Parser`
+        template <typename Parser>
+        void add_subcommand(std::string_view name, const char * help = nullptr);
+
+        /**
+         * @brief parse command line arguments without touching the acceptors
+         *
+         * The acceptors are only matched, not given the arguments, and
+         * values are checked by ArgumentAcceptor::check(), so that a value
+         * that cannot be converted fails the parse at its token (e.g.
+         * ParseErrorCode::bad_value). Arguments are recorded in the result
+         * as views into `argv` (or into response files owned by the result).
+         *
+         * @param argc number of command line arguments
+         * @param argv command line argument vector
+         * @param[out] result parse result; its storage is reused
+         * @return parse status, also stored in the result; no exception
+         *   is thrown for invalid arguments, and storage that cannot be
+         *   allocated is reported as ParseErrorCode::out_of_memory
+         *
+         * @note an acceptor accepts only once unless AcceptorInfo::repeatable
+         */
+        ParseStatus parse(int argc, const char * argv[], ParseResult & result) const noexcept;
+        /// @see ParseStatus parse(int argc, const char * argv[], ParseResult & result) const noexcept
+        ParseResult parse(int argc, const char * argv[]) const;
+
+        /**
+         * @brief answer a shell completion request, if the arguments are one
+         *
+         * A request is "prog --__complete WORD...", where the words are those
+         * of the command line being completed after the program name, the
+         * last being the one under the cursor (maybe empty). Candidates for
+         * it are printed one per line: names of indexed options (including
+         * "no-" forms), subcommand names, or the choices of the option that
+         * takes it as argument (see AcceptorInfo::choices). Words before it
+         * are walked through the index to skip option arguments and to enter
+         * subcommands. Nothing is accepted or recorded, so a program can
+         * answer before initializing anything else:
+         *
+         * @code
+         * if (parser.complete(argc, argv, std::cout))
+         *     return 0;
+         * @endcode
+         *
+         * @param argc number of command line arguments
+         * @param argv command line argument vector
+         * @param out output of candidates
+         * @return whether the arguments are a completion request
+         *
+         * @see print_completion_script()
+         */
+        bool complete(int argc, const char * argv[], std::ostream & out) const;
+
+        /**
+         * @brief print a script that makes a shell complete a program by complete()
+         *
+         * The script asks the program for candidates on each completion,
+         * e.g. "source <(prog --completion-script bash)" in bash, if the
+         * program prints it on such an option.
+         *
+         * @param out output stream
+         * @param shell shell to write for
+         * @param prog program name, as typed in the shell
+         */
+        static std::ostream & print_completion_script(std::ostream & out,
+            CompletionShell shell, std::string_view prog);
+
+        /**
+         * @brief parse a NUL-separated blob, as read from /proc/<pid>/cmdline
+         *
+         * The blob is walked in place: no argument vector is built and each
+         * token is measured once. Arguments are recorded as views into the
+         * blob, which shall outlive the result. Response files are not
+         * expanded and ParseResult::args() is empty.
+         *
+         * @param data the blob, each token followed by a '\0'
+         * @param size bytes of the blob, including the last '\0'
+         * @param[out] result parse result; its storage is reused
+         * @return parse status, also stored in the result
+         *
+         * @see ParseStatus parse(int argc, const char * argv[], ParseResult & result) const noexcept
+         */
+        ParseStatus parse_cmdline(const char * data, std::size_t size,
+            ParseResult & result) const noexcept;
+
+        /**
+         * @brief parse many argument vectors on a pool of threads
+         *
+         * Each vector is parsed, and its values converted, as by parse(),
+         * whose errors, such as a value that is not valid, are in its result.
+         *
+         * @param argvs argument vectors
+         * @param n_threads number of threads; 0 to use hardware concurrency
+         * @return results in the order of `argvs`
+         *
+         * @throw std::bad_alloc if the results cannot be allocated
+         *
+         * @see ParseStatus parse(int argc, const char * argv[], ParseResult & result) const noexcept
          */
-        void set_acceptors(ArgumentAcceptor * const * begin, ArgumentAcceptor * const * end) noexcept;
+        std::vector<ParseResult> parse_batch(Span<const ArgVector> argvs,
+            unsigned int n_threads = 0) const;
+    };
+
+    /// argument parser, which gives parsed arguments to the acceptors
+    class ArgumentParser: public ArgumentSchema
+    {
+    private:
+        std::string_view prog_name;
+        std::list<MappedFile> response_files; ///< files of last parse
+        std::vector<const char*> expanded_args; ///< argv with response files expanded
+        std::vector<TokenInfo> token_info; ///< per arg of last parse
+        Arena arena; ///< storage of acceptors for last parse
+        std::vector<std::uint64_t> given; ///< per acceptor bits, set if given in last parse
+        std::vector<std::uint64_t> completed; ///< per acceptor bits, set if completed in last parse
+        std::vector<std::uint8_t> state; ///< per acceptor parse state, mirrored from the acceptors
+        std::string missing_names; ///< names of missing required acceptors of last parse
+        MappedFile config; ///< config file of last parse
+
+        mutable std::mutex help_mutex;
+        mutable std::atomic<bool> help_ready{false};
+        mutable std::string help_cache; ///< help text, built on first use
+        mutable std::atomic<std::uint32_t> help_generation{0}; ///< schema generation of help_cache
+        mutable std::string help_prog; ///< program name in help_cache
+
+        const Subcommand * selected = nullptr; ///< subcommand of last parse
+        std::exception_ptr failure; ///< exception thrown by an acceptor in last parse
+
+        void layout_help() const;
+        template <typename Tokens> ParseStatus run(Tokens & tokens) noexcept;
+        template <typename Tokens> ParseStatus accept_tokens(Tokens & tokens);
+        void raise(const ParseStatus & status, Span<const char * const> args);
+
+        friend struct ArgumentSchema::Accepting;
+
+    public:
+        using ArgumentSchema::ArgumentSchema;
+
+        /**
+         * @brief parse command line arguments, reporting how parsing ended
+         *
+         * Nothing is thrown: a special option (e.g. "--help") ends parsing
+         * with ParseErrorCode::special, and a value that an acceptor cannot
+         * convert with the code of its error (e.g. ParseErrorCode::bad_value),
+         * at its token. ParseStatus::message() formats the status.
+         *
+         * @param argc number of command line arguments
+         * @param argv command line argument vector
+         * @return parse status; texts in it point into `argv` or response files
+         */
+        ParseStatus try_parse(int argc, const char * argv[]) noexcept;
 
         /**
          * @brief parse command line arguments
@@ -160,10 +1062,71 @@ namespace hgl::ap
          * @param argc number of command line arguments
          * @param argv command line argument vector
          *
-         * @throw ArgumentParseError if error occurs
+         * @throw ArgumentParseError if error occurs; errors of acceptors are
+         *  thrown as they threw them
+         * @throw SpecialOption * if a special option is given
+         *
+         * @see try_parse(), enable_response_files()
          */
         void operator()(int argc, const char * argv[]);
 
+        /**
+         * @brief parse a NUL-separated blob, as read from /proc/<pid>/cmdline
+         *
+         * The texts given to acceptors are views into the blob, which shall
+         * outlive their use. Response files are not expanded.
+         *
+         * @param data the blob, each token followed by a '\0'
+         * @param size bytes of the blob, including the last '\0'
+         *
+         * @throw ArgumentParseError if error occurs
+         * @throw SpecialOption * if a special option is given
+         */
+        void parse_cmdline(const char * data, std::size_t size);
+
+        /// name of the subcommand selected by last parse, or empty
+        std::string_view subcommand() const noexcept
+        { return selected ? std::string_view(selected->name) : std::string_view(); }
+        /// parser of the subcommand selected by last parse, or nullptr
+        ArgumentParser * subcommand_parser() const noexcept
+        { return selected ? selected->parser.get() : nullptr; }
+
+        /**
+         * @brief convert all values of last parse that are converted lazily
+         *
+         * @throw ArgumentParseError if a value is invalid
+         *
+         * @see LazyOption
+         */
+        void validate() const;
+
+        /**
+         * @brief get help text, which is laid out on first call and cached
+         *
+         * Columns are sized over all acceptors. It is safe to call it from
+         * many threads, but not during a parse.
+         *
+         * @note the text is laid out again if the acceptors or the program
+         *  name change
+         */
+        std::string_view help_text() const;
+
+        /**
+         * @brief write help text to a file descriptor
+         *
+         * @return false if writing fails (errno is set)
+         */
+        bool write_help(int fd) const;
+
+        /**
+         * @brief copy help text into a buffer, like snprintf()
+         *
+         * @param buffer output buffer, which is always NUL-terminated if `size` > 0
+         * @param size buffer size
+         * @return length of the full help text
+         */
+        std::size_t copy_help(char * buffer, std::size_t size) const;
+
         /**
          * @brief print help infomation
          *
@@ -179,6 +1142,7 @@ namespace hgl::ap
     protected:
         std::string_view _long_opt;
         const char     * help_info;
+        std::string_view _env_var; ///< valid if _bit_1 (reading environment) is set
 
         auto & long_opt() noexcept { return _long_opt; }
         auto & short_opt() noexcept { return reinterpret_cast<char&>(_u8); }
@@ -193,6 +1157,10 @@ namespace hgl::ap
         virtual void accept(std::string_view opt_name, int n, const char ** text) override;
         using ArgumentAcceptor::accept;
 
+        /// throw ArgumentParseError for a text that is none of `choices`
+        [[noreturn]] static void throw_bad_choice(std::string_view text,
+            Span<const std::string_view> choices);
+
     public:
         static constexpr char no_short_option = '\0';
         static constexpr std::string_view no_long_option = "";
@@ -211,9 +1179,27 @@ namespace hgl::ap
         Option(char short_option, std::string_view long_option,
             bool required = true, int param_num = 1, const char * help = nullptr);
 
+        /**
+         * @brief read the option from an environment variable if not given in arguments
+         *
+         * The variable is read after the command line arguments, only if the
+         * option is not given there. For an option that takes no argument,
+         * the values "", "0", "false", "no" and "off" count as not given.
+         * Options taking more than one argument cannot be read from variables.
+         *
+         * @param env_var variable name; empty to use the schema's prefix
+         *   (see ArgumentSchema::set_env_prefix()) and get_name()
+         *
+         * @note call it before the option is given to a schema
+         */
+        Option & set_env(std::string_view env_var = {}) noexcept;
+
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
         virtual void get_name(std::string & name) const noexcept override;
         virtual void print_useage(std::ostream & out) const noexcept override;
         virtual void print_helpinfo(std::ostream & out) const noexcept override;
+        virtual void format_usage(std::string & out) const override;
+        virtual bool get_helpinfo(std::string & names, std::string_view & help) const override;
     };
 
     /// text argument (no option name)
@@ -222,30 +1208,57 @@ namespace hgl::ap
     protected:
         std::string_view name;
 
+        std::string_view default_text;
+        bool             has_default = false;
+
         virtual int acceptable(std::nullptr_t) const noexcept override;
         virtual void accept(std::string_view text) override;
+        virtual void begin_parse(Arena & arena) noexcept override;
+
+        template <typename... Opts> friend class StaticArgumentParser;
 
     public:
-        std::string_view text;
+        using value_type = std::string_view;
+
+        std::string_view text; ///< as held at the first parse, restored by later ones
 
         TextArg(std::string_view name, bool required);
 
+        /// get text from a parse result
+        value_type decode(const ParseResult::Occurrence & occ) const noexcept { return occ.value; }
+
         virtual void get_name(std::string & name) const noexcept override;
         virtual void print_useage(std::ostream & out) const noexcept override;
         virtual void print_helpinfo(std::ostream & out) const noexcept override;
+        virtual void format_usage(std::string & out) const override;
+        virtual bool get_helpinfo(std::string & names, std::string_view & help) const override;
     };
 
 
-    /// option that takes one value
+    /**
+     * @brief option that takes one value
+     *
+     * The value held when ArgumentParser first parses is the default; each
+     * later parse starts from it again, so values of options not given are
+     * not left over from the previous parse.
+     */
     template <typename T> struct SignleValueOption: Option
     {
         using value_type = T;
 
-        value_type value;
+        value_type value{};
 
         SignleValueOption(char short_option, std::string_view long_option,
             bool required = true, const char * help = nullptr):
             Option(short_option, long_option, required, 1, help) {}
+
+    protected:
+        value_type default_value{};
+        bool       has_default = false;
+
+        virtual void begin_parse(Arena & arena) noexcept override;
+
+        template <typename... Opts> friend class StaticArgumentParser;
     };
 
     template <> struct SignleValueOption<bool>: Option
@@ -258,6 +1271,20 @@ namespace hgl::ap
 
         value_type value() const noexcept { return _bit_0; }
         void value(value_type v) noexcept { _bit_0 = v; }
+
+    protected:
+        bool default_value = false;
+        bool has_default = false;
+
+        virtual void begin_parse(Arena &) noexcept override
+        {
+            if (has_default)
+                _bit_0 = default_value;
+            else
+                default_value = _bit_0, has_default = true;
+        }
+
+        template <typename... Opts> friend class StaticArgumentParser;
     };
 
     struct FlagOption: SignleValueOption<bool>
@@ -267,48 +1294,349 @@ namespace hgl::ap
         SignleValueOption<bool>(short_option, long_option, required, help)
         { n_args() = 0; }
 
+        /// get value from a parse result
+        value_type decode(const ParseResult::Occurrence & occ) const noexcept;
+
     protected:
         virtual int acceptable(std::string_view long_opt) const noexcept override;
         virtual void accept(std::string_view text, std::nullptr_t) override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
     };
 
     struct BoolOption: SignleValueOption<bool>
     {
         using SignleValueOption<bool>::SignleValueOption;
 
+        /// convert text from a parse result
+        value_type decode(const ParseResult::Occurrence & occ) const;
+
     protected:
         virtual void accept(std::string_view text) override;
+        virtual void check(std::string_view text) const override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
     };
 
-    struct IntOption: SignleValueOption<long>
+    /**
+     * @brief option holding an integer or a floating-point number
+     *
+     * Texts are converted with `std::from_chars()`, so that conversion does
+     * not depend on the locale and never reads beyond the text, which need
+     * not be NUL-terminated. Integers may have a sign and a "0x" (hex) or
+     * "0" (octal) prefix. Out-of-range values and trailing characters are
+     * rejected.
+     *
+     * @note instantiated for all standard integer types except `bool` and
+     *   plain `char`, and for `float` and `double`
+     */
+    template <typename T> struct NumberOption: SignleValueOption<T>
     {
-        using SignleValueOption<long>::SignleValueOption;
+        using SignleValueOption<T>::SignleValueOption;
+
+        /// convert text from a parse result
+        T decode(const ParseResult::Occurrence & occ) const;
+
+        /**
+         * @brief convert text to number
+         *
+         * @throw ArgumentParseError if the text is not a valid literal or is out of range
+         */
+        static T from_text(std::string_view text);
 
     protected:
         virtual void accept(std::string_view text) override;
+        virtual void check(std::string_view text) const override;
+    };
+
+    using Int8Option   = NumberOption<std::int8_t>;
+    using Int16Option  = NumberOption<std::int16_t>;
+    using Int32Option  = NumberOption<std::int32_t>;
+    using Int64Option  = NumberOption<std::int64_t>;
+    using UInt8Option  = NumberOption<std::uint8_t>;
+    using UInt16Option = NumberOption<std::uint16_t>;
+    using UInt32Option = NumberOption<std::uint32_t>;
+    using UInt64Option = NumberOption<std::uint64_t>;
+
+    struct IntOption: NumberOption<long>
+    {
+        using NumberOption<long>::NumberOption;
+    };
+
+    struct FloatOption: NumberOption<double>
+    {
+        using NumberOption<double>::NumberOption;
     };
 
-    struct FloatOption: SignleValueOption<double>
+    struct StringOption: SignleValueOption<std::string_view>
     {
-        using SignleValueOption<double>::SignleValueOption;
+        using SignleValueOption<std::string_view>::SignleValueOption;
+
+        /// convert text from a parse result
+        value_type decode(const ParseResult::Occurrence & occ) const;
 
     protected:
         virtual void accept(std::string_view text) override;
     };
 
-    struct StringOption: SignleValueOption<std::string_view>
+    /// name of a choice and the value it stands for
+    template <typename E> struct EnumChoice
     {
-        using SignleValueOption<std::string_view>::SignleValueOption;
+        std::string_view name;
+        E                value;
+    };
+
+    /// view of a ChoiceTable, whatever its size
+    template <typename E> class EnumChoices
+    {
+    private:
+        const EnumChoice<E>    * choices = nullptr;
+        const std::string_view * names = nullptr;
+        const std::uint32_t    * seeds = nullptr;
+        const std::uint16_t    * slots = nullptr;
+        std::uint32_t            n = 0;
+        std::uint32_t            mask = 0;
+
+    public:
+        constexpr EnumChoices() noexcept = default;
+        constexpr EnumChoices(const EnumChoice<E> * choices, const std::string_view * names,
+            const std::uint32_t * seeds, const std::uint16_t * slots,
+            std::uint32_t n, std::uint32_t mask) noexcept:
+            choices(choices), names(names), seeds(seeds), slots(slots), n(n), mask(mask) {}
+
+        /// hash of a name, varied by seed
+        static constexpr std::uint32_t hash(std::string_view name, std::uint32_t seed) noexcept;
+
+        /// choice of a name, or nullptr; one name is compared
+        constexpr const EnumChoice<E> * find(std::string_view name) const noexcept;
+        /// names in declaration order
+        constexpr Span<const std::string_view> all_names() const noexcept { return {names, n}; }
+    };
+
+    /**
+     * @brief choices indexed by a perfect hash, built at compile time
+     *
+     * The first hash of a name picks a seed, with which the second hash
+     * gives the only slot the name can be in. Seeds are searched when the
+     * table is constructed, largest groups first (hash and displace), so a
+     * table declared `constexpr` costs nothing at startup.
+     *
+     * @code
+     * enum class Level { debug, info, warn };
+     * static constexpr auto levels = make_choices<Level>({
+     *     {"debug", Level::debug}, {"info", Level::info}, {"warn", Level::warn}});
+     * EnumOption<Level> o_level('l', "log-level", false, levels);
+     * @endcode
+     */
+    template <typename E, std::size_t N> class ChoiceTable
+    {
+        static_assert(N > 0 && N < UINT16_MAX, "bad number of choices");
+
+    public:
+        static constexpr std::size_t n_slots = [] {
+            std::size_t n = 1;
+            while (n < N)
+                n *= 2;
+            return n;
+        }();
+
+        EnumChoice<E>    choices[N] = {};
+        std::string_view names[N] = {};
+        std::uint32_t    seeds[n_slots] = {}; ///< by first hash
+        std::uint16_t    slots[n_slots] = {}; ///< choice index by second hash, N if empty
+
+        /// @throw std::invalid_argument if names are duplicated, which fails a constant initialization
+        constexpr explicit ChoiceTable(const EnumChoice<E> (&list)[N]);
+
+        constexpr operator EnumChoices<E>() const noexcept
+        {
+            return {choices, names, seeds, slots, std::uint32_t(N), std::uint32_t(n_slots - 1)};
+        }
+        constexpr const EnumChoice<E> * find(std::string_view name) const noexcept
+        { return EnumChoices<E>(*this).find(name); }
+    };
+
+    /// @see ChoiceTable
+    template <typename E, std::size_t N>
+    constexpr ChoiceTable<E, N> make_choices(const EnumChoice<E> (&list)[N])
+    {
+        return ChoiceTable<E, N>(list);
+    }
+
+    /**
+     * @brief option taking one of fixed names, each standing for a value
+     *
+     * @note the table of choices shall outlive the option
+     */
+    template <typename E> struct EnumOption: SignleValueOption<E>
+    {
+        using typename SignleValueOption<E>::value_type;
+
+        template <std::size_t N>
+        EnumOption(char short_option, std::string_view long_option, bool required,
+            const ChoiceTable<E, N> & choices, const char * help = nullptr):
+            SignleValueOption<E>(short_option, long_option, required, help), choices(choices) {}
+
+        /**
+         * @brief convert text to value
+         *
+         * @throw ArgumentParseError if the text is none of the choices, listing them
+         */
+        E from_text(std::string_view text) const;
+        /// convert text from a parse result
+        E decode(const ParseResult::Occurrence & occ) const { return this->from_text(occ.value); }
+
+    protected:
+        EnumChoices<E> choices;
+
+        virtual void accept(std::string_view text) override;
+        virtual void check(std::string_view text) const override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
+    };
+
+    /**
+     * @brief option that can be given many times, collecting all values
+     *
+     * Values are appended to a buffer in the parser's arena, which stays
+     * valid until the next parse. If a separator is given, a text like
+     * "a,b,c" gives three values.
+     *
+     * @note instantiated for `std::string_view` and the types of NumberOption
+     */
+    template <typename T> class ListOption: public Option
+    {
+    private:
+        Arena       * arena = nullptr;
+        T           * items = nullptr;
+        std::uint32_t count = 0;
+        std::uint32_t capacity = 0;
+        char          separator;
+
+        void push(std::string_view text);
 
     protected:
+        virtual void begin_parse(Arena & arena) noexcept override;
         virtual void accept(std::string_view text) override;
+        virtual void check(std::string_view text) const override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
+
+    public:
+        ListOption(char short_option, std::string_view long_option,
+            bool required = false, const char * help = nullptr, char separator = '\0'):
+            Option(short_option, long_option, required, 1, help), separator(separator) {}
+
+        /// values of last parse, in order
+        Span<const T> values() const noexcept { return {items, count}; }
+
+        /**
+         * @brief convert all occurrences in a parse result
+         *
+         * @throw ArgumentParseError if a text cannot be converted
+         */
+        std::vector<T> decode_all(const ParseResult & result) const;
     };
 
-    /// throw pointer to self when accepting
+    using MultiStringOption = ListOption<std::string_view>;
+
+    /**
+     * @brief option collecting numbers from comma-separated lists, with ranges of integers
+     *
+     * A text like "8000-8003,9000" gives 8000, 8001, 8002, 8003 and 9000; a
+     * range may descend. Values of all occurrences are stored in order in
+     * one buffer in the parser's arena, which is sized by the number of
+     * commas before converting, and stays valid until the next parse.
+     * Plain decimal integers are converted 8 digits at a time; other forms
+     * are converted as NumberOption does.
+     *
+     * @note instantiated for the types of NumberOption
+     */
+    template <typename T> class NumericListOption: public Option
+    {
+    private:
+        Arena       * arena = nullptr;
+        T           * items = nullptr;
+        std::size_t   count = 0;
+        std::size_t   capacity = 0;
+
+        void reserve(std::size_t n);
+
+    protected:
+        virtual void begin_parse(Arena & arena) noexcept override;
+        virtual void accept(std::string_view text) override;
+        virtual void check(std::string_view text) const override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
+
+    public:
+        NumericListOption(char short_option, std::string_view long_option,
+            bool required = false, const char * help = nullptr):
+            Option(short_option, long_option, required, 1, help) {}
+
+        /// values of last parse, in order
+        Span<const T> values() const noexcept { return {items, count}; }
+
+        /**
+         * @brief convert all occurrences in a parse result
+         *
+         * @throw ArgumentParseError if a text cannot be converted
+         */
+        std::vector<T> decode_all(const ParseResult & result) const;
+    };
+
+    /**
+     * @brief option whose text is converted on first access, not when accepted
+     *
+     * A parse only records the text. value() converts it with `Opt::decode()`
+     * and caches the result; ArgumentParser::validate() converts all lazy
+     * options at once, to fail fast.
+     *
+     * @tparam Opt an option taking one argument, e.g. IntOption
+     *
+     * @note value() is not thread safe
+     */
+    template <typename Opt> class LazyOption: public Opt
+    {
+    public:
+        using value_type = typename Opt::value_type;
+
+    private:
+        enum : std::uint8_t { absent, given, converted };
+
+        std::string_view           raw;
+        mutable value_type         cache{};
+        mutable std::uint8_t       state = absent;
+
+        const value_type & convert() const;
+
+    protected:
+        virtual void begin_parse(Arena & arena) noexcept override;
+        virtual void accept(std::string_view text) override;
+        /// values are converted on first access, not when parsed
+        virtual void check(std::string_view) const override {}
+        virtual void validate() const override;
+
+    public:
+        using Opt::Opt;
+
+        /// whether the option is given in last parse
+        bool present() const noexcept { return state != absent; }
+        /// text of the option as given
+        std::string_view text() const noexcept { return raw; }
+
+        /**
+         * @brief get the value, converting the text on first call
+         *
+         * @param default_value value to return if the option is not given
+         *
+         * @throw ArgumentParseError if the text cannot be converted
+         */
+        value_type value(value_type default_value = {}) const
+        { return state == absent ? default_value : this->convert(); }
+    };
+
+    /// option that stops parsing when given, e.g. "--help"
     class SpecialOption: public Option
     {
     private:
         virtual void accept(std::nullptr_t) override;
+        virtual bool get_info(AcceptorInfo & info) const noexcept override;
 
     public:
         SpecialOption(char short_option, std::string_view long_option,
@@ -316,9 +1644,60 @@ namespace hgl::ap
             Option(short_option, long_option, false, 0, help) {}
     };
 
+    extern template struct NumberOption<signed char>;
+    extern template struct NumberOption<short>;
+    extern template struct NumberOption<int>;
+    extern template struct NumberOption<long>;
+    extern template struct NumberOption<long long>;
+    extern template struct NumberOption<unsigned char>;
+    extern template struct NumberOption<unsigned short>;
+    extern template struct NumberOption<unsigned int>;
+    extern template struct NumberOption<unsigned long>;
+    extern template struct NumberOption<unsigned long long>;
+    extern template struct NumberOption<float>;
+    extern template struct NumberOption<double>;
+
+    extern template class ListOption<std::string_view>;
+    extern template class ListOption<signed char>;
+    extern template class ListOption<short>;
+    extern template class ListOption<int>;
+    extern template class ListOption<long>;
+    extern template class ListOption<long long>;
+    extern template class ListOption<unsigned char>;
+    extern template class ListOption<unsigned short>;
+    extern template class ListOption<unsigned int>;
+    extern template class ListOption<unsigned long>;
+    extern template class ListOption<unsigned long long>;
+    extern template class ListOption<float>;
+    extern template class ListOption<double>;
+
 } // namespace hgl::ap
 
 
+inline hgl::ap::MappedFile::MappedFile(MappedFile && other) noexcept:
+    addr(other.addr), length(other.length)
+{
+    other.addr = nullptr;
+    other.length = 0;
+}
+
+inline hgl::ap::MappedFile::~MappedFile()
+{
+    this->close();
+}
+
+inline hgl::ap::MappedFile &
+hgl::ap::MappedFile::operator=(MappedFile && other) noexcept
+{
+    if (this != &other)
+    {
+        this->close();
+        this->addr = other.addr, this->length = other.length;
+        other.addr = nullptr, other.length = 0;
+    }
+    return *this;
+}
+
 inline void hgl::ap::ArgumentAcceptor::mark_completed() noexcept
 {
     completed = true;
@@ -327,27 +1706,190 @@ inline void hgl::ap::ArgumentAcceptor::mark_completed() noexcept
     accepting_restarg = false;
 }
 
-inline hgl::ap::ArgumentParser::ArgumentParser(
-    std::initializer_list<ArgumentAcceptor*> aas):
-    acceptors{.p_beg=aas.begin(), .p_end=aas.end()}
+template <typename T>
+inline void hgl::ap::SignleValueOption<T>::begin_parse(Arena &) noexcept
+{
+    if (this->has_default)
+        this->value = this->default_value;
+    else
+        this->default_value = this->value, this->has_default = true;
+}
+
+template <typename Opt>
+inline const typename hgl::ap::LazyOption<Opt>::value_type &
+hgl::ap::LazyOption<Opt>::convert() const
+{
+    if (this->state == given)
+    {
+        const ParseResult::Occurrence occ{const_cast<LazyOption *>(this), 0,
+            {}, this->raw, nullptr, 1, ArgSource::command_line};
+        this->cache = this->decode(occ);
+        this->state = converted;
+    }
+    return this->cache;
+}
+
+template <typename Opt>
+inline void hgl::ap::LazyOption<Opt>::begin_parse(Arena & arena) noexcept
+{
+    Opt::begin_parse(arena);
+    this->state = absent;
+}
+
+template <typename Opt>
+inline void hgl::ap::LazyOption<Opt>::accept(std::string_view text)
+{
+    this->raw = text;
+    this->state = given;
+
+    this->mark_completed();
+}
+
+template <typename Opt>
+inline void hgl::ap::LazyOption<Opt>::validate() const
+{
+    if (this->state == given)
+        this->convert();
+}
+
+template <typename E>
+constexpr std::uint32_t hgl::ap::EnumChoices<E>::hash(std::string_view name, std::uint32_t seed) noexcept
+{
+    std::uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (const char ch: name)
+        h = (h ^ static_cast<unsigned char>(ch)) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+template <typename E>
+constexpr const hgl::ap::EnumChoice<E> *
+hgl::ap::EnumChoices<E>::find(std::string_view name) const noexcept
+{
+    const std::uint32_t seed = this->seeds[hash(name, 0) & this->mask];
+    const std::uint16_t i = this->slots[hash(name, seed) & this->mask];
+    return i < this->n && this->choices[i].name == name ? &this->choices[i] : nullptr;
+}
+
+template <typename E, std::size_t N>
+constexpr hgl::ap::ChoiceTable<E, N>::ChoiceTable(const EnumChoice<E> (&list)[N])
+{
+    using Hash = EnumChoices<E>;
+    constexpr std::uint32_t mask = n_slots - 1;
+
+    std::uint32_t group[N] = {};
+    std::uint32_t group_size[n_slots] = {};
+    for (std::size_t i = 0; i < N; i++)
+    {
+        this->choices[i] = list[i];
+        this->names[i] = list[i].name;
+        for (std::size_t k = 0; k < i; k++)
+        {
+            if (this->names[k] == this->names[i])
+                throw std::invalid_argument("duplicated choice");
+        }
+
+        group[i] = Hash::hash(this->names[i], 0) & mask;
+        group_size[group[i]]++;
+    }
+
+    for (auto & slot: this->slots)
+        slot = std::uint16_t(N);
+
+    for (std::uint32_t size = N; size > 0; size--)
+    {
+        for (std::uint32_t g = 0; g < n_slots; g++)
+        {
+            if (group_size[g] != size)
+                continue;
+
+            // the first seed that puts all names of the group into free slots
+            for (std::uint32_t seed = 1; ; seed++)
+            {
+                std::uint32_t taken[N] = {};
+                std::uint32_t n_taken = 0;
+                for (std::size_t i = 0; i < N && n_taken != ~0u; i++)
+                {
+                    if (group[i] != g)
+                        continue;
+
+                    const std::uint32_t slot = Hash::hash(this->names[i], seed) & mask;
+                    bool vacant = this->slots[slot] == N;
+                    for (std::uint32_t k = 0; k < n_taken; k++)
+                        vacant = vacant && taken[k] != slot;
+                    taken[n_taken] = slot;
+                    n_taken = vacant ? n_taken + 1 : ~0u;
+                }
+                if (n_taken == ~0u)
+                    continue;
+
+                for (std::size_t i = 0, k = 0; i < N; i++)
+                {
+                    if (group[i] == g)
+                        this->slots[taken[k++]] = std::uint16_t(i);
+                }
+                this->seeds[g] = seed;
+                break;
+            }
+        }
+    }
+}
+
+template <typename E>
+inline E hgl::ap::EnumOption<E>::from_text(std::string_view text) const
+{
+    if (const auto choice = this->choices.find(text))
+        return choice->value;
+    Option::throw_bad_choice(text, this->choices.all_names());
+}
+
+template <typename E>
+inline void hgl::ap::EnumOption<E>::accept(std::string_view text)
+{
+    this->value = this->from_text(text);
+
+    this->mark_completed();
+}
+
+template <typename E>
+inline void hgl::ap::EnumOption<E>::check(std::string_view text) const
+{
+    this->from_text(text);
+}
+
+template <typename E>
+inline bool hgl::ap::EnumOption<E>::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.choices = this->choices.all_names();
+    return true;
+}
+
+template <typename Parser>
+inline void hgl::ap::ArgumentSchema::add_subcommand(std::string_view name, const char * help)
+{
+    this->add_subcommand(name,
+        [] () -> std::unique_ptr<ArgumentParser> { return std::make_unique<Parser>(); }, help);
+}
+
+inline hgl::ap::ArgumentSchema::ArgumentSchema(
+    std::initializer_list<ArgumentAcceptor*> aas)
 {
+    this->set_acceptors(aas.begin(), aas.end());
 #ifndef NDEBUG
     this->chech_health();
 #endif // NDEBUG
 }
 
-inline hgl::ap::ArgumentParser::ArgumentParser(
-    ArgumentAcceptor * const * aa_begin, ArgumentAcceptor * const * aa_end):
-    acceptors{.p_beg=aa_begin, .p_end=aa_end}
+inline hgl::ap::ArgumentSchema::ArgumentSchema(
+    ArgumentAcceptor * const * aa_begin, ArgumentAcceptor * const * aa_end)
 {
+    this->set_acceptors(aa_begin, aa_end);
 #ifndef NDEBUG
     this->chech_health();
 #endif // NDEBUG
 }
 
-inline void hgl::ap::ArgumentParser::set_acceptors(
-    ArgumentAcceptor * const * begin, ArgumentAcceptor * const * end) noexcept
+inline void hgl::ap::ArgumentSchema::enable_response_files(bool enabled) noexcept
 {
-    this->acceptors.p_beg = begin;
-    this->acceptors.p_end = end;
+    this->response_files_enabled = enabled;
 }
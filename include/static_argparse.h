@@ -0,0 +1,491 @@
+/**
+ * @file static_argparse.h
+ * @brief HGL command line argument parser for acceptors known at compile time
+ */
+
+#pragma once
+
+#include "argparse.h"
+
+#include <bitset>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace hgl::ap
+{
+    /**
+     * @brief argument parser over a fixed set of acceptors, held by value
+     *
+     * It takes the same syntax as ArgumentParser and reports errors with the
+     * same ParseStatus codes and messages. Names are read once at
+     * construction into a hash table of long names and a table of short
+     * ones, tokens are dispatched to tuple elements by comparing indexes
+     * known at compile time, and values of FlagOption, SpecialOption,
+     * BoolOption, StringOption, NumberOption (IntOption, FloatOption, ...),
+     * EnumOption and TextArg are converted by their non-virtual functions,
+     * which can be inlined.
+     *
+     * Types derived from those (e.g. LazyOption) and other acceptors that
+     * report their names by get_info() are given their arguments through
+     * ArgumentAcceptor::accept(), as by ArgumentParser. Response files,
+     * environment variables, config files, subcommands and abbreviations
+     * are not supported.
+     *
+     * @code
+     * StaticArgumentParser<FlagOption, IntOption> parser(
+     *     FlagOption('v', "verbose", false), IntOption('n', "number", true));
+     * parser(argc, argv);
+     * long n = parser.get<1>().value;
+     * @endcode
+     */
+    template <typename... Opts>
+    class StaticArgumentParser
+    {
+    public:
+        static constexpr std::size_t size = sizeof...(Opts);
+
+    private:
+        static_assert(size < UINT8_MAX, "too many acceptors");
+
+        static constexpr std::uint8_t none = UINT8_MAX; ///< no acceptor
+
+        /// buckets of the long name table, kept at most half full
+        static constexpr std::size_t n_buckets = [] {
+            std::size_t n = 2;
+            while (n < 2 * size)
+                n *= 2;
+            return n;
+        }();
+
+        std::tuple<Opts...> opts;
+        AcceptorInfo infos[size == 0 ? 1 : size];
+        std::uint8_t short_index[256]; ///< acceptor by short option byte
+        std::uint8_t long_index[n_buckets]; ///< acceptor by hash of long option name, linearly probed
+        std::uint32_t long_hashes[n_buckets];
+        std::bitset<size> required;
+        std::bitset<size> taken; ///< accepted in last parse
+        std::string missing_names;
+        Arena arena; ///< given to acceptors that convert values themselves
+
+        template <typename Opt> static constexpr bool is_text = std::is_base_of_v<TextArg, Opt>;
+
+        template <typename T> struct is_number : std::false_type {};
+        template <typename T> struct is_number<NumberOption<T>> : std::true_type {};
+        template <typename E> struct is_enum : std::false_type {};
+        template <typename E> struct is_enum<EnumOption<E>> : std::true_type {};
+
+        /**
+         * @brief whether values of `Opt` are set by this class, without virtual calls
+         *
+         * Only the acceptor types themselves are, as types derived from them
+         * may accept otherwise (e.g. LazyOption); those get their values
+         * through ArgumentAcceptor::accept(), as from ArgumentParser.
+         */
+        template <typename Opt> static constexpr bool is_direct =
+            std::is_same_v<Opt, FlagOption> || std::is_same_v<Opt, BoolOption>
+            || std::is_same_v<Opt, StringOption> || std::is_same_v<Opt, TextArg>
+            || std::is_same_v<Opt, IntOption> || std::is_same_v<Opt, FloatOption>
+            || is_number<Opt>::value || is_enum<Opt>::value
+            || std::is_base_of_v<SpecialOption, Opt>;
+
+        static std::uint32_t hash(std::string_view name) noexcept;
+
+        void build_index() noexcept;
+        bool accepting(std::size_t i) const noexcept
+        { return !this->taken[i] || this->infos[i].repeatable; }
+        std::size_t lookup(std::string_view name) const noexcept;
+        std::size_t find_long(std::string_view name, bool & negated) const noexcept;
+        std::size_t find_text() const noexcept;
+
+        template <typename F, std::size_t... I>
+        void visit(std::size_t i, F && f, std::index_sequence<I...>);
+        template <typename Opt>
+        static void accept(Opt & opt, std::string_view name, std::string_view value,
+            bool negated, int n, const char ** args);
+
+    public:
+        explicit StaticArgumentParser(Opts... opts);
+
+        /// the `I`th acceptor
+        template <std::size_t I> auto & get() noexcept { return std::get<I>(opts); }
+        /// @see get()
+        template <std::size_t I> const auto & get() const noexcept { return std::get<I>(opts); }
+
+        /**
+         * @brief parse command line arguments
+         *
+         * Values of acceptors not given are restored to those held at the
+         * first parse, as ArgumentParser does.
+         *
+         * @return parse status; texts in it point into `argv`
+         *
+         * @throw ArgumentParseError if a value cannot be converted, with the
+         *  token and acceptor of the value, as ArgumentParser reports them
+         * @throw SpecialOption * if a special option is given, as ArgumentParser does
+         */
+        ParseStatus parse(int argc, const char * argv[]);
+
+        /**
+         * @brief parse command line arguments
+         *
+         * @throw ArgumentParseError if error occurs
+         *
+         * @see ArgumentParser::operator()()
+         */
+        void operator()(int argc, const char * argv[]);
+    };
+}
+
+
+template <typename... Opts>
+hgl::ap::StaticArgumentParser<Opts...>::StaticArgumentParser(Opts... opts):
+    opts(std::move(opts)...)
+{
+    this->build_index();
+}
+
+/// FNV-1a hash of a name
+template <typename... Opts>
+std::uint32_t hgl::ap::StaticArgumentParser<Opts...>::hash(std::string_view name) noexcept
+{
+    std::uint32_t h = 2166136261u;
+    for (const char ch: name)
+        h = (h ^ static_cast<unsigned char>(ch)) * 16777619u;
+    return h;
+}
+
+template <typename... Opts>
+void hgl::ap::StaticArgumentParser<Opts...>::build_index() noexcept
+{
+    std::memset(this->short_index, none, sizeof this->short_index);
+    std::memset(this->long_index, none, sizeof this->long_index);
+
+    std::size_t i = 0;
+    std::apply([this, &i] (const auto & ... opt) {
+        ((
+            // read once, through the base class to which this class is a friend
+            static_cast<const ArgumentAcceptor &>(opt).get_info(this->infos[i]),
+            this->infos[i].n_args = is_text<std::decay_t<decltype(opt)>> ? 1 : this->infos[i].n_args,
+            this->required[i] = static_cast<const ArgumentAcceptor &>(opt).required,
+            ++i
+        ), ...);
+    }, this->opts);
+
+    // the first acceptor of a name wins, as in ArgumentParser
+    for (std::size_t k = size; k-- > 0; )
+    {
+        if (this->infos[k].short_opt != '\0')
+            this->short_index[static_cast<unsigned char>(this->infos[k].short_opt)] = std::uint8_t(k);
+    }
+    for (std::size_t k = 0; k < size; k++)
+    {
+        const std::string_view name = this->infos[k].long_opt;
+        if (name.empty() || this->lookup(name) != size)
+            continue;
+
+        const std::uint32_t h = hash(name);
+        std::size_t b = h & (n_buckets - 1);
+        while (this->long_index[b] != none)
+            b = (b + 1) & (n_buckets - 1);
+        this->long_index[b] = std::uint8_t(k);
+        this->long_hashes[b] = h;
+    }
+}
+
+template <typename... Opts>
+std::size_t hgl::ap::StaticArgumentParser<Opts...>::lookup(std::string_view name) const noexcept
+{
+    const std::uint32_t h = hash(name);
+    for (std::size_t b = h & (n_buckets - 1); this->long_index[b] != none; b = (b + 1) & (n_buckets - 1))
+    {
+        const std::size_t i = this->long_index[b];
+        if (this->long_hashes[b] == h && this->infos[i].long_opt == name)
+            return i;
+    }
+    return size;
+}
+
+template <typename... Opts>
+std::size_t hgl::ap::StaticArgumentParser<Opts...>::find_long(
+    std::string_view name, bool & negated) const noexcept
+{
+    using namespace std::literals::string_view_literals;
+
+    negated = false;
+    if (const auto i = this->lookup(name); i != size)
+        return i;
+
+    if (name.substr(0, 3) == "no-"sv)
+    {
+        const auto i = this->lookup(name.substr(3));
+        if (i != size && this->infos[i].negatable)
+            return negated = true, i;
+    }
+
+    return size;
+}
+
+template <typename... Opts>
+std::size_t hgl::ap::StaticArgumentParser<Opts...>::find_text() const noexcept
+{
+    std::size_t i = 0, found = size;
+    ((found == size && is_text<Opts> && this->accepting(i) ? (void)(found = i) : (void)0, ++i), ...);
+    return found;
+}
+
+template <typename... Opts>
+template <typename F, std::size_t... I>
+void hgl::ap::StaticArgumentParser<Opts...>::visit(
+    std::size_t i, F && f, std::index_sequence<I...>)
+{
+    // each case is a direct call, which can be inlined
+    (void)((i == I ? (f(std::get<I>(this->opts)), true) : false) || ...);
+}
+
+template <typename... Opts>
+template <typename Opt>
+void hgl::ap::StaticArgumentParser<Opts...>::accept(Opt & opt, std::string_view name,
+    std::string_view value, bool negated, int n, const char ** args)
+{
+    if constexpr (!is_direct<Opt>)
+    {
+        ArgumentAcceptor & aa = opt;
+        if (n == 0)
+            aa.accept(name, nullptr);
+        else if (n == 1)
+            aa.accept(name, value);
+        else
+            aa.accept(name, n, args);
+    }
+    else if constexpr (std::is_base_of_v<SpecialOption, Opt>)
+        throw static_cast<SpecialOption *>(&opt);
+    else if constexpr (std::is_same_v<FlagOption, Opt>)
+        opt.value(!negated);
+    else if constexpr (std::is_same_v<TextArg, Opt>)
+        opt.text = value;
+    else if constexpr (std::is_same_v<StringOption, Opt>)
+        opt.value = value;
+    else
+    {
+        ParseResult::Occurrence occ{&opt, 0, {}, value, nullptr, 1, ArgSource::command_line};
+        if constexpr (std::is_same_v<BoolOption, Opt>)
+            opt.value(opt.decode(occ));
+        else
+            opt.value = opt.decode(occ);
+    }
+}
+
+template <typename... Opts>
+hgl::ap::ParseStatus hgl::ap::StaticArgumentParser<Opts...>::parse(int argc, const char * argv[])
+{
+    using namespace std::literals::string_view_literals;
+
+    const auto seq = std::index_sequence_for<Opts...>();
+    this->taken.reset();
+
+    this->arena.reset();
+    auto begin = [this] (auto & opt) {
+        using Opt = std::decay_t<decltype(opt)>;
+        if constexpr (is_direct<Opt>)
+            opt.Opt::begin_parse(this->arena); // not virtual
+        else
+            static_cast<ArgumentAcceptor &>(opt).begin_parse(this->arena);
+    };
+    std::apply([&begin] (auto & ... opt) { (begin(opt), ...); }, this->opts);
+
+    std::size_t token = 0;
+    std::string_view cur_opt;
+
+    auto acceptor = [this] (std::size_t i) {
+        const ArgumentAcceptor * aa = nullptr;
+        this->visit(i, [&aa] (const auto & opt) { aa = &opt; }, std::index_sequence_for<Opts...>());
+        return aa;
+    };
+
+    auto fail = [&] (ParseErrorCode code, std::size_t i,
+            std::string_view text = {}, int detail = 0) -> ParseStatus {
+        return {code, detail, token, i < size ? acceptor(i) : nullptr, text};
+    };
+
+    // give acceptor `i` its arguments, locating conversion errors at the current token
+    auto take = [&] (std::size_t i, std::string_view name, std::string_view value,
+            bool negated, int n, const char ** args) {
+        try
+        {
+            this->visit(i, [&] (auto & opt) { accept(opt, name, value, negated, n, args); }, seq);
+        }
+        catch (ArgumentParseError & e)
+        {
+            e.locate(token, acceptor(i));
+            throw;
+        }
+        this->taken[i] = true;
+    };
+
+    // accept acceptor `i` with the arguments in the tokens after `k`, which is moved to the last
+    auto accept_next = [&] (std::size_t i, int & k, std::string_view name) {
+        const int n = this->infos[i].n_args;
+        if (n >= argc - k)
+            return false;
+        for (int a = 1; a <= n; a++)
+        {
+            if (argv[k + a][0] == '-')
+                return false;
+        }
+
+        const char ** const args = argv + k + 1;
+        k += n;
+        take(i, name, args[0], false, n, args);
+        return true;
+    };
+
+    for (int k = 1; k < argc; k++)
+    {
+        token = std::size_t(k);
+        cur_opt = argv[k];
+
+        if (cur_opt == "--"sv)
+        {
+            for (++k; k < argc; k++)
+            {
+                token = std::size_t(k);
+
+                const auto i = this->find_text();
+                if (i == size)
+                    continue;
+
+                --k;
+                if (!accept_next(i, k, {}))
+                    return fail(ParseErrorCode::too_few_arguments, i);
+                break;
+            }
+        }
+        else if (cur_opt == "-"sv)
+        {
+            const auto i = this->find_text();
+            if (i == size)
+                return fail(ParseErrorCode::unexpected_argument, size, cur_opt);
+
+            take(i, {}, cur_opt, false, 1, nullptr);
+        }
+        else if (cur_opt.substr(0, 2) == "--"sv)
+        {
+            cur_opt.remove_prefix(2);
+
+            std::string_view value;
+            const auto equal_pos = cur_opt.find('=');
+            if (equal_pos != cur_opt.npos)
+            {
+                value = cur_opt.substr(equal_pos + 1);
+                cur_opt.remove_suffix(value.size() + 1);
+            }
+
+            bool negated;
+            const auto i = this->find_long(cur_opt, negated);
+            if (i == size || !this->accepting(i))
+            {
+                return fail(i == size ? ParseErrorCode::unknown_option :
+                    ParseErrorCode::duplicated_option, size, cur_opt);
+            }
+
+            const int n = this->infos[i].n_args;
+            if (n == 0)
+            {
+                if (equal_pos != cur_opt.npos)
+                    return fail(ParseErrorCode::unexpected_value, i, cur_opt);
+
+                take(i, cur_opt, {}, negated, 0, nullptr);
+            }
+            else if (equal_pos != cur_opt.npos)
+            {
+                if (n != 1)
+                    return fail(ParseErrorCode::value_count, i, cur_opt, n);
+
+                take(i, cur_opt, value, false, 1, nullptr);
+            }
+            else if (!accept_next(i, k, cur_opt))
+            {
+                return fail(ParseErrorCode::too_few_arguments, i, cur_opt, n);
+            }
+        }
+        else if (!cur_opt.empty() && cur_opt.front() == '-')
+        {
+            const std::string_view cluster = cur_opt.substr(1);
+
+            for (std::size_t c = 0; c < cluster.size(); c++)
+            {
+                cur_opt = cluster.substr(c, 1);
+                const std::string_view value = cluster.substr(c + 1);
+
+                const std::size_t i = this->short_index[static_cast<unsigned char>(cluster[c])];
+                if (i == none || !this->accepting(i))
+                {
+                    return fail(i == none ? ParseErrorCode::unknown_option :
+                        ParseErrorCode::duplicated_option, size, cur_opt);
+                }
+
+                const int n = this->infos[i].n_args;
+                if (n == 0)
+                {
+                    take(i, cur_opt, {}, false, 0, nullptr);
+                    continue; // following chars are options
+                }
+
+                if (!value.empty())
+                {
+                    if (n != 1)
+                        return fail(ParseErrorCode::value_count, i, cur_opt, n);
+
+                    take(i, cur_opt, value, false, 1, nullptr);
+                }
+                else if (!accept_next(i, k, cur_opt))
+                {
+                    return fail(ParseErrorCode::too_few_arguments, i, cur_opt, n);
+                }
+
+                break;
+            }
+        }
+        else
+        {
+            const auto i = this->find_text();
+            if (i == size)
+                return fail(ParseErrorCode::unexpected_argument, size, cur_opt);
+
+            take(i, {}, cur_opt, false, 1, nullptr);
+        }
+    }
+
+    const auto missing = this->required & ~this->taken;
+    if (missing.none())
+        return {};
+
+    std::size_t first = size;
+    this->missing_names.clear();
+    for (std::size_t i = 0; i < size; i++)
+    {
+        if (!missing[i])
+            continue;
+
+        std::string name;
+        acceptor(i)->get_name(name);
+        if (first == size)
+            first = i;
+        else
+            this->missing_names += ", ";
+        this->missing_names += name;
+    }
+
+    return {ParseErrorCode::missing_required, int(missing.count()), std::size_t(argc),
+        acceptor(first), this->missing_names};
+}
+
+template <typename... Opts>
+void hgl::ap::StaticArgumentParser<Opts...>::operator()(int argc, const char * argv[])
+{
+    const auto status = this->parse(argc, argv);
+    if (!status.ok())
+        throw ArgumentParseError(status, {argv, std::size_t(argc)});
+}
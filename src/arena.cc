@@ -0,0 +1,90 @@
+#include <argparse.h>
+#include "profile.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+using namespace hgl::ap;
+
+/// size of the first block
+static constexpr std::size_t _arena_min_block = 4096;
+
+static char * _align_up(char * p, std::size_t align) noexcept
+{
+    const auto addr = reinterpret_cast<std::uintptr_t>(p);
+    return reinterpret_cast<char *>((addr + align - 1) & ~(std::uintptr_t(align) - 1));
+}
+
+Arena::~Arena()
+{
+    while (this->blocks)
+    {
+        Block * const next = this->blocks->next;
+        ::operator delete(this->blocks);
+        this->blocks = next;
+    }
+}
+
+void * Arena::allocate(std::size_t size, std::size_t align)
+{
+    assert(align && !(align & (align - 1)) && align <= alignof(std::max_align_t));
+    HGL_AP_COUNT_CURRENT(allocations);
+
+    char * p = _align_up(this->cur, align);
+    if (this->cur == nullptr || p + size > this->end)
+    {
+        // blocks grow geometrically, so that n bytes cost O(log n) allocations
+        std::size_t block_size = this->blocks ? this->blocks->size * 2 : _arena_min_block;
+        block_size = std::max(block_size, size + align);
+
+        auto * const block = static_cast<Block *>(::operator new(sizeof(Block) + block_size));
+        block->next = this->blocks;
+        block->size = block_size;
+        this->blocks = block;
+
+        this->cur = reinterpret_cast<char *>(block + 1);
+        this->end = this->cur + block_size;
+        p = _align_up(this->cur, align);
+    }
+
+    this->cur = p + size;
+    return p;
+}
+
+void * Arena::grow(void * p, std::size_t old_size, std::size_t new_size, std::size_t align)
+{
+    assert(new_size >= old_size);
+
+    char * const q = static_cast<char *>(p);
+    if (q && q + old_size == this->cur && q + new_size <= this->end)
+    {
+        this->cur = q + new_size;
+        return p;
+    }
+
+    void * const r = this->allocate(new_size, align);
+    if (old_size)
+        std::memcpy(r, p, old_size);
+    return r;
+}
+
+void Arena::reset() noexcept
+{
+    if (!this->blocks)
+        return;
+
+    Block * const head = this->blocks;
+    for (Block * b = head->next; b; )
+    {
+        Block * const next = b->next;
+        ::operator delete(b);
+        b = next;
+    }
+    head->next = nullptr;
+
+    this->cur = reinterpret_cast<char *>(head + 1);
+    this->end = this->cur + head->size;
+}
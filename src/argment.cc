@@ -1,12 +1,23 @@
 #include <argparse.h>
 #include <stdexcept>
 
+#ifdef __cpp_lib_bitops
+#   include <bit>
+#endif
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <charconv>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <limits>
 #include <sstream>
+#include <system_error>
+#include <type_traits>
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
 
 using namespace hgl::ap;
 
@@ -25,30 +36,43 @@ int ArgumentAcceptor::acceptable(std::nullptr_t) const noexcept
     return -1;
 }
 
-[[noreturn]] static void
-_throw_bad_accept(const ArgumentAcceptor * aa, int argn, const char ** args)
+bool ArgumentAcceptor::get_info(AcceptorInfo & info) const noexcept
 {
-    std::stringstream ss;
-    std::string name;
+    return false;
+}
+
+void ArgumentAcceptor::begin_parse(Arena & arena) noexcept
+{
+}
 
-    aa->get_name(name);
-    ss << "bad arguments for " << name << ':' << ' ';
+void ArgumentAcceptor::validate() const
+{
+}
 
-    while (argn -- > 0)
-        ss << *(args++);
+void ArgumentAcceptor::check(std::string_view text) const
+{
+}
 
-    throw ArgumentParseError(ss.str());
+void ArgumentAcceptor::format_usage(std::string & out) const
+{
+    std::ostringstream ss;
+    this->print_useage(ss);
+    out += ss.str();
+}
+
+bool ArgumentAcceptor::get_helpinfo(std::string & names, std::string_view & help) const
+{
+    return false;
 }
 
 void ArgumentAcceptor::accept(std::nullptr_t)
 {
-    _throw_bad_accept(this, 0, nullptr);
+    throw ArgumentParseError(this, 0, {});
 }
 
 void ArgumentAcceptor::accept(std::string_view text)
 {
-    const char * arg[1] = {text.data()};
-    _throw_bad_accept(this, 1, arg);
+    throw ArgumentParseError(this, 1, text);
 }
 
 void ArgumentAcceptor::accept(int n, const char ** text)
@@ -60,7 +84,7 @@ void ArgumentAcceptor::accept(int n, const char ** text)
     else if (n == 1)
         this->accept(*text);
     else
-        _throw_bad_accept(this, n, text);
+        throw ArgumentParseError(this, n, {}, {text, std::size_t(n)});
 }
 
 void ArgumentAcceptor::accept(std::string_view opt_name, std::nullptr_t)
@@ -111,12 +135,37 @@ Option::Option(char short_option, std::string_view long_option,
         short_option != no_short_option, false, required, short_option, param_num),
     _long_opt(long_option), help_info(help == nullptr ? "" : help)
 {
+    this->_bit_1 = false;
+
     assert(param_num == this->n_args());
 
     if (short_option == no_short_option && long_option == no_long_option)
         throw std::invalid_argument("neither short_option nor long_option is provided");
 }
 
+bool Option::get_info(AcceptorInfo & info) const noexcept
+{
+    info.long_opt = this->long_opt();
+    info.short_opt = this->short_opt();
+    info.negatable = false;
+    info.n_args = this->n_args();
+    info.env = this->_bit_1 && this->n_args() <= 1;
+    info.env_var = this->_env_var;
+    return true;
+}
+
+void Option::throw_bad_choice(std::string_view text, Span<const std::string_view> choices)
+{
+    throw ArgumentParseError(text, choices);
+}
+
+Option & Option::set_env(std::string_view env_var) noexcept
+{
+    this->_bit_1 = true;
+    this->_env_var = env_var;
+    return *this;
+}
+
 void Option::get_name(std::string & name) const noexcept
 {
     name.clear();
@@ -140,69 +189,78 @@ void Option::get_name(std::string & name) const noexcept
 }
 
 
-void Option::print_useage(std::ostream & out) const noexcept
+void Option::format_usage(std::string & out) const
 {
-    static std::string buffer; // not thread safe !!
-
-    if (!this->required) out << '[';
+    if (!this->required) out += '[';
 
     if (this->short_opt() != no_short_option)
-        out << '-' << this->short_opt();
+        out += '-', out += this->short_opt();
     else
-        out << "--" << this->long_opt();
+        out += "--", out += this->long_opt();
 
     if (this->n_args())
     {
-        out << ' ';
-        this->get_name(buffer);
-            out << buffer;
+        std::string name;
+        this->get_name(name);
+        out += ' ', out += name;
         if (this->n_args() > 1)
-            out << "...";
+            out += "...";
     }
 
-    if (!this->required) out << ']';
+    if (!this->required) out += ']';
 }
 
-void Option::print_helpinfo(std::ostream & out) const noexcept
+bool Option::get_helpinfo(std::string & names, std::string_view & help) const
 {
-    static std::string name, buffer; // not thread safe !!
-    constexpr auto left_width = 25;
-
+    std::string name;
     this->get_name(name);
-    buffer.clear();
 
-    auto print_args = [&] {
+    auto append_args = [&] {
         if (this->n_args() == 0)
             return;
-        buffer += ' ';
-        buffer += name;
+        names += ' ';
+        names += name;
         if (this->n_args() > 1)
-            buffer += "...";
+            names += "...";
     };
 
+    names.clear();
+
     if (this->short_opt() != no_short_option)
     {
-        buffer += '-';
-        buffer += this->short_opt();
-        print_args();
+        names += '-';
+        names += this->short_opt();
+        append_args();
     }
 
     if (this->long_opt() != no_long_option)
     {
         if (this->short_opt() != no_short_option)
-            buffer += ", ";
+            names += ", ";
 
-        buffer += "--";
-        buffer += this->long_opt();
-        print_args();
+        names += "--";
+        names += this->long_opt();
+        append_args();
     }
 
+    help = this->help_info;
+    return true;
+}
 
-    if (this->help_info == nullptr)
-    {
-        out << buffer;
-        return;
-    }
+void Option::print_useage(std::ostream & out) const noexcept
+{
+    std::string buffer;
+    this->format_usage(buffer);
+    out << buffer;
+}
+
+void Option::print_helpinfo(std::ostream & out) const noexcept
+{
+    constexpr auto left_width = 25;
+
+    std::string buffer;
+    std::string_view help;
+    this->get_helpinfo(buffer, help);
 
     auto pos_diff = buffer.length();
     if (pos_diff > left_width)
@@ -216,7 +274,7 @@ void Option::print_helpinfo(std::ostream & out) const noexcept
         out << std::setfill(' ') << std::setw(left_width) << std::left << buffer;
     }
 
-    out << ' ' << ' ' << this->help_info << '\n';
+    out << ' ' << ' ' << help << '\n';
 }
 
 
@@ -237,6 +295,14 @@ void TextArg::accept(std::string_view text)
     this->mark_completed();
 }
 
+void TextArg::begin_parse(Arena & arena) noexcept
+{
+    if (this->has_default)
+        this->text = this->default_text;
+    else
+        this->default_text = this->text, this->has_default = true;
+}
+
 void TextArg::get_name(std::string & name) const noexcept
 {
     name.clear();
@@ -256,6 +322,19 @@ void TextArg::print_helpinfo(std::ostream & out) const noexcept
 {
 }
 
+void TextArg::format_usage(std::string & out) const
+{
+    if (!this->required) out += '[';
+    out += this->name;
+    if (!this->required) out += ']';
+}
+
+bool TextArg::get_helpinfo(std::string & names, std::string_view & help) const
+{
+    names.clear(); // no help line
+    return true;
+}
+
 
 int FlagOption::acceptable(std::string_view long_opt) const noexcept
 {
@@ -265,7 +344,7 @@ int FlagOption::acceptable(std::string_view long_opt) const noexcept
 
     const bool ok = long_opt == this->long_opt() || (
 #ifdef __cpp_lib_starts_ends_with
-        long_opt.startwith("no-")
+        long_opt.starts_with("no-")
 #else
         long_opt.substr(0, 3) == "no-"sv
 #endif
@@ -274,85 +353,568 @@ int FlagOption::acceptable(std::string_view long_opt) const noexcept
     return ok ? this->n_args() : -1;
 }
 
-void FlagOption::accept(std::string_view text, std::nullptr_t)
+static bool _is_negated_flag(std::string_view long_opt, std::string_view text) noexcept
 {
     using namespace std::literals::string_view_literals;
 
-    const bool no =
+    return
 #ifdef __cpp_lib_starts_ends_with
-        text.startwith("no-")
+        text.starts_with("no-")
 #else
         text.substr(0, 3) == "no-"sv
 #endif
     &&
 #ifdef __cpp_lib_starts_ends_with
-        !this->long_opt().startwith("no-")
+        !long_opt.starts_with("no-")
 #else
-        this->long_opt().substr(0, 3) != "no-"sv
+        long_opt.substr(0, 3) != "no-"sv
 #endif
     ;
+}
+
+void FlagOption::accept(std::string_view text, std::nullptr_t)
+{
+    this->value(!_is_negated_flag(this->long_opt(), text));
+}
+
+FlagOption::value_type FlagOption::decode(const ParseResult::Occurrence & occ) const noexcept
+{
+    return !_is_negated_flag(this->long_opt(), occ.name);
+}
+
+bool FlagOption::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.negatable = this->long_opt() != no_long_option;
+    info.repeatable = true;
+    return true;
+}
 
-    this->value(!no);
+/// literals of BoolOption; the words come first, to be offered by completion
+static constexpr auto _bool_literals = make_choices<bool>({
+    {"true", true}, {"false", false}, {"yes", true}, {"no", false}, {"on", true}, {"off", false},
+    {"1", true}, {"0", false}, {"", true},
+});
+static constexpr std::size_t _n_bool_words = 6;
+
+static bool _bool_from_text(std::string_view text)
+{
+    if (const auto literal = _bool_literals.find(text))
+        return literal->value;
+
+    throw ArgumentParseError(ParseErrorCode::bad_value, "not a valid bool literal: ", text);
 }
 
 void BoolOption::accept(std::string_view text)
 {
-    if (text == "1" || text == "true" || text == "on" || text == "yes" || text.empty())
-        this->value(true);
-    else if (text == "0" || text == "false" || text == "off" || text == "no")
-        this->value(false);
-    else
+    this->value(_bool_from_text(text));
+
+    this->mark_completed();
+}
+
+void BoolOption::check(std::string_view text) const
+{
+    _bool_from_text(text);
+}
+
+BoolOption::value_type BoolOption::decode(const ParseResult::Occurrence & occ) const
+{
+    return _bool_from_text(occ.value);
+}
+
+bool BoolOption::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.choices = {_bool_literals.names, _n_bool_words};
+    return true;
+}
+
+[[noreturn]] static void _throw_bad_number(ParseErrorCode code, const char * what, std::string_view text)
+{
+    throw ArgumentParseError(code, what, text);
+}
+
+template <typename T>
+static std::enable_if_t<std::is_integral_v<T>, T> _number_from_text(std::string_view text)
+{
+    const char * p = text.data();
+    const char * const end = p + text.size();
+
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    int base = 10;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        base = 16, p += 2;
+    else if (end - p > 1 && p[0] == '0')
+        base = 8, p += 1;
+
+    unsigned long long magnitude;
+    const auto [last, ec] = std::from_chars(p, end, magnitude, base);
+    if (p == end || last != end || *p == '+' || *p == '-')
+        _throw_bad_number(ParseErrorCode::bad_value, "not a valid int literal: ", text);
+
+    constexpr auto max = static_cast<unsigned long long>(std::numeric_limits<T>::max());
+    if (ec == std::errc::result_out_of_range
+            || magnitude > max + (negative && std::is_signed_v<T>)
+            || (negative && std::is_unsigned_v<T> && magnitude != 0))
+        _throw_bad_number(ParseErrorCode::value_out_of_range, "int literal out of range: ", text);
+
+    if constexpr (std::is_signed_v<T>)
     {
-        std::string msg("not a valid bool literal: ");
-        msg += text;
-        throw ArgumentParseError(std::move(msg));
+        if (negative && magnitude != 0) // -(m - 1) - 1 does not overflow for the minimum
+            return static_cast<T>(-static_cast<T>(magnitude - 1) - 1);
     }
+    return static_cast<T>(magnitude);
+}
+
+template <typename T>
+static std::enable_if_t<std::is_floating_point_v<T>, T> _number_from_text(std::string_view text)
+{
+    const char * p = text.data();
+    const char * const end = p + text.size();
+
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    auto format = std::chars_format::general;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        format = std::chars_format::hex, p += 2;
+
+    T value;
+    const auto [last, ec] = std::from_chars(p, end, value, format);
+    if (p == end || last != end || *p == '+' || *p == '-')
+        _throw_bad_number(ParseErrorCode::bad_value, "not a valid float literal: ", text);
+    if (ec == std::errc::result_out_of_range)
+        _throw_bad_number(ParseErrorCode::value_out_of_range, "float literal out of range: ", text);
+
+    return negative ? -value : value;
+}
+
+template <typename T> T NumberOption<T>::from_text(std::string_view text)
+{
+    return _number_from_text<T>(text);
+}
+
+template <typename T> void NumberOption<T>::accept(std::string_view text)
+{
+    this->value = _number_from_text<T>(text);
 
     this->mark_completed();
 }
 
-void IntOption::accept(std::string_view text)
+template <typename T> void NumberOption<T>::check(std::string_view text) const
 {
-    auto str = text.data();
-    char * end;
+    _number_from_text<T>(text);
+}
 
-    this->value = std::strtol(str, &end, 0);
+template <typename T> T NumberOption<T>::decode(const ParseResult::Occurrence & occ) const
+{
+    return _number_from_text<T>(occ.value);
+}
 
-    if (this->value == 0 && str == end)
+template struct hgl::ap::NumberOption<signed char>;
+template struct hgl::ap::NumberOption<short>;
+template struct hgl::ap::NumberOption<int>;
+template struct hgl::ap::NumberOption<long>;
+template struct hgl::ap::NumberOption<long long>;
+template struct hgl::ap::NumberOption<unsigned char>;
+template struct hgl::ap::NumberOption<unsigned short>;
+template struct hgl::ap::NumberOption<unsigned int>;
+template struct hgl::ap::NumberOption<unsigned long>;
+template struct hgl::ap::NumberOption<unsigned long long>;
+template struct hgl::ap::NumberOption<float>;
+template struct hgl::ap::NumberOption<double>;
+
+void StringOption::accept(std::string_view text)
+{
+    this->value = text;
+
+    this->mark_completed();
+}
+
+StringOption::value_type StringOption::decode(const ParseResult::Occurrence & occ) const
+{
+    return occ.value;
+}
+
+template <typename T> static T _list_item_from_text(std::string_view text)
+{
+    if constexpr (std::is_same_v<T, std::string_view>)
+        return text;
+    else
+        return NumberOption<T>::from_text(text);
+}
+
+/// call `fn` with each item of a list text
+template <typename Fn> static void _split_list(std::string_view text, char separator, Fn && fn)
+{
+    if (separator != '\0')
     {
-        std::string msg("not a valid int literal: ");
-        msg += text;
-        throw ArgumentParseError(std::move(msg));
+        for (std::size_t pos; (pos = text.find(separator)) != text.npos; )
+        {
+            fn(text.substr(0, pos));
+            text.remove_prefix(pos + 1);
+        }
     }
 
-    this->mark_completed();
+    fn(text);
 }
 
-void FloatOption::accept(std::string_view text)
+template <typename T> void ListOption<T>::begin_parse(Arena & arena) noexcept
 {
-    auto str = text.data();
-    char * end;
+    this->arena = &arena;
+    this->items = nullptr;
+    this->count = 0;
+    this->capacity = 0;
+}
 
-    this->value = std::strtod(str, &end);
+template <typename T> void ListOption<T>::push(std::string_view text)
+{
+    const T item = _list_item_from_text<T>(text);
 
-    if (this->value == 0 && str == end)
+    if (this->count == this->capacity)
     {
-        std::string msg("not a valid float literal: ");
-        msg += text;
-        throw ArgumentParseError(std::move(msg));
+        assert(this->arena); // only ArgumentParser gives arguments to acceptors
+
+        const std::uint32_t new_capacity = this->capacity ? this->capacity * 2 : 8;
+        this->items = static_cast<T *>(this->arena->grow(this->items,
+            this->capacity * sizeof(T), new_capacity * sizeof(T), alignof(T)));
+        this->capacity = new_capacity;
     }
 
-    this->mark_completed();
+    this->items[this->count++] = item;
 }
 
-void StringOption::accept(std::string_view text)
+template <typename T> void ListOption<T>::accept(std::string_view text)
 {
-    this->value = text;
+    _split_list(text, this->separator, [this] (std::string_view item) { this->push(item); });
 
-    this->mark_completed();
+    this->completed = true; // still accepting
+}
+
+template <typename T> void ListOption<T>::check(std::string_view text) const
+{
+    _split_list(text, this->separator, [] (std::string_view item) { _list_item_from_text<T>(item); });
+}
+
+template <typename T> bool ListOption<T>::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.repeatable = true;
+    return true;
+}
+
+template <typename T> std::vector<T> ListOption<T>::decode_all(const ParseResult & result) const
+{
+    std::vector<T> values;
+
+    for (const auto & occ : result.occurrences())
+    {
+        if (occ.acceptor != this)
+            continue;
+
+        _split_list(occ.value, this->separator, [&values] (std::string_view item) {
+            values.push_back(_list_item_from_text<T>(item));
+        });
+    }
+
+    return values;
+}
+
+template class hgl::ap::ListOption<std::string_view>;
+template class hgl::ap::ListOption<signed char>;
+template class hgl::ap::ListOption<short>;
+template class hgl::ap::ListOption<int>;
+template class hgl::ap::ListOption<long>;
+template class hgl::ap::ListOption<long long>;
+template class hgl::ap::ListOption<unsigned char>;
+template class hgl::ap::ListOption<unsigned short>;
+template class hgl::ap::ListOption<unsigned int>;
+template class hgl::ap::ListOption<unsigned long>;
+template class hgl::ap::ListOption<unsigned long long>;
+template class hgl::ap::ListOption<float>;
+template class hgl::ap::ListOption<double>;
+
+/// largest number of values a range may give
+static constexpr std::size_t _max_range_size = std::size_t(1) << 24;
+
+/// number of `ch` in a text
+static std::size_t _count_char(std::string_view text, char ch) noexcept
+{
+    std::size_t n = 0, i = 0;
+#ifdef __SSE2__
+    const __m128i pattern = _mm_set1_epi8(ch);
+    for (; i + 16 <= text.size(); i += 16)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i));
+        const auto bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern)));
+#ifdef __cpp_lib_bitops
+        n += static_cast<std::size_t>(std::popcount(bits));
+#else
+        n += static_cast<std::size_t>(__builtin_popcount(bits));
+#endif
+    }
+#endif
+    for (; i < text.size(); i++)
+        n += text[i] == ch;
+    return n;
+}
+
+/**
+ * @brief convert the decimal digits at the beginning of a text, 8 bytes at a time
+ *
+ * @param[out] value value of the digits; only meaningful for at most 19 of them
+ * @return end of the digits
+ */
+static const char * _scan_digits(const char * p, const char * end, std::uint64_t & value) noexcept
+{
+    std::uint64_t v = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - p >= 8)
+    {
+        std::uint64_t x;
+        std::memcpy(&x, p, 8);
+
+        // a byte is in '0' .. '9' iff its high nibble is 3, and still is with 6 added;
+        // a carry out of a byte only disturbs bytes after the first non-digit
+        constexpr std::uint64_t high = 0xf0f0f0f0f0f0f0f0u, zeros = 0x3030303030303030u;
+        const std::uint64_t bad = ((x & high) ^ zeros) | (((x + 0x0606060606060606u) & high) ^ zeros);
+#ifdef __cpp_lib_bitops
+        const int n = bad == 0 ? 8 : std::countr_zero(bad) / 8;
+#else
+        const int n = bad == 0 ? 8 : __builtin_ctzll(bad) / 8;
+#endif
+        if (n == 0)
+            break;
+
+        // keep the digits, and move them up so that zero bytes lead
+        const std::uint64_t mask = n == 8 ? ~std::uint64_t(0) : (std::uint64_t(1) << (8 * n)) - 1;
+        x = ((x & mask) - (zeros & mask)) << (8 * (8 - n));
+
+        // combine digits pairwise in parallel: 8 x 1 -> 4 x 2 -> 2 x 4 -> 8
+        x = (x * 10 + (x >> 8)) & 0x00ff00ff00ff00ffu;
+        x = (x * 100 + (x >> 16)) & 0x0000ffff0000ffffu;
+        x = (x * 10000 + (x >> 32)) & 0xffffffffu;
+
+        static constexpr std::uint32_t scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+        v = v * scale[n] + x;
+        p += n;
+        if (n < 8)
+            break;
+    }
+#endif
+    for (; p != end && *p >= '0' && *p <= '9'; ++p)
+        v = v * 10 + std::uint64_t(*p - '0');
+
+    value = v;
+    return p;
+}
+
+/**
+ * @brief convert a plain decimal integer at the beginning of a text
+ *
+ * @return end of the integer, or nullptr if the text does not begin with one
+ *   of that form (e.g. hex, octal, too many digits) or it is out of range
+ */
+template <typename T>
+static const char * _decimal_prefix(const char * p, const char * end, T & value) noexcept
+{
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-'))
+        negative = *p++ == '-';
+
+    std::uint64_t magnitude;
+    const char * const last = _scan_digits(p, end, magnitude);
+    const auto n = last - p;
+    if (n == 0 || n > 18 || (*p == '0' && n > 1)) // 18 digits never overflow
+        return nullptr;
+
+    const auto signed_value = negative ? -std::int64_t(magnitude) : std::int64_t(magnitude);
+    if constexpr (std::is_signed_v<T>)
+    {
+        if (signed_value < static_cast<std::int64_t>(std::numeric_limits<T>::min()))
+            return nullptr;
+    }
+    else if (negative && magnitude != 0)
+    {
+        return nullptr;
+    }
+    if (!negative && magnitude > std::uint64_t(std::numeric_limits<T>::max()))
+        return nullptr;
+
+    value = static_cast<T>(signed_value);
+    return last;
+}
+
+template <typename T> static T _list_number_from_text(std::string_view text)
+{
+    if constexpr (std::is_integral_v<T>)
+    {
+        T value;
+        const char * const end = text.data() + text.size();
+        if (_decimal_prefix(text.data(), end, value) == end)
+            return value;
+    }
+    return _number_from_text<T>(text);
+}
+
+/**
+ * @brief convert a comma-separated list of numbers and ranges
+ *
+ * @param reserve called with the number of values to come, at least
+ * @param push called with each value
+ */
+template <typename T, typename Reserve, typename Push>
+static void _parse_numeric_list(std::string_view text, Reserve && reserve, Push && push)
+{
+    std::size_t n_items = _count_char(text, ',') + 1;
+    reserve(n_items);
+
+    const char * p = text.data();
+    const char * const end = p + text.size();
+    for (;; ++p) // p is at an item, then at the comma after it
+    {
+        --n_items; // items after this one
+
+        if constexpr (std::is_integral_v<T>)
+        {
+            // plain decimals end where their digits do, without searching for commas
+            T value;
+            const char * const last = _decimal_prefix(p, end, value);
+            if (last && (last == end || *last == ','))
+            {
+                push(value);
+                p = last;
+                if (p == end)
+                    break;
+                continue;
+            }
+        }
+
+        const auto comma = static_cast<const char *>(std::memchr(p, ',', std::size_t(end - p)));
+        const std::string_view item(p, std::size_t((comma ? comma : end) - p));
+        p += item.size();
+
+        // "lo-hi", where lo may have a sign; floats have no ranges, and '-' may be in exponents
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (const auto dash = item.find('-', 1); dash != item.npos)
+            {
+                using U = std::make_unsigned_t<T>;
+
+                const T lo = _list_number_from_text<T>(item.substr(0, dash));
+                const T hi = _list_number_from_text<T>(item.substr(dash + 1));
+                const std::uint64_t distance = lo <= hi ? U(U(hi) - U(lo)) : U(U(lo) - U(hi));
+                if (distance >= _max_range_size)
+                    _throw_bad_number(ParseErrorCode::value_out_of_range, "range too large: ", item);
+
+                reserve(std::size_t(distance) + 1 + n_items);
+                for (T v = lo; ; lo <= hi ? ++v : --v)
+                {
+                    push(v);
+                    if (v == hi)
+                        break;
+                }
+                if (p == end)
+                    break;
+                continue;
+            }
+        }
+
+        push(_list_number_from_text<T>(item));
+        if (p == end)
+            break;
+    }
+}
+
+template <typename T> void NumericListOption<T>::begin_parse(Arena & arena) noexcept
+{
+    this->arena = &arena;
+    this->items = nullptr;
+    this->count = 0;
+    this->capacity = 0;
+}
+
+/// make room for `n` more values
+template <typename T> void NumericListOption<T>::reserve(std::size_t n)
+{
+    if (this->count + n <= this->capacity)
+        return;
+
+    assert(this->arena); // only ArgumentParser gives arguments to acceptors
+
+    const std::size_t new_capacity = std::max(this->count + n, this->capacity * 2);
+    this->items = static_cast<T *>(this->arena->grow(this->items,
+        this->capacity * sizeof(T), new_capacity * sizeof(T), alignof(T)));
+    this->capacity = new_capacity;
+}
+
+template <typename T> void NumericListOption<T>::accept(std::string_view text)
+{
+    _parse_numeric_list<T>(text,
+        [this] (std::size_t n) { this->reserve(n); },
+        [this] (T v) { this->items[this->count++] = v; });
+
+    this->completed = true; // still accepting
+}
+
+template <typename T> void NumericListOption<T>::check(std::string_view text) const
+{
+    _parse_numeric_list<T>(text, [] (std::size_t) {}, [] (T) {});
+}
+
+template <typename T> bool NumericListOption<T>::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.repeatable = true;
+    return true;
 }
 
+template <typename T>
+std::vector<T> NumericListOption<T>::decode_all(const ParseResult & result) const
+{
+    std::vector<T> values;
+
+    for (const auto & occ : result.occurrences())
+    {
+        if (occ.acceptor != this)
+            continue;
+
+        _parse_numeric_list<T>(occ.value,
+            [&values] (std::size_t n) {
+                if (values.size() + n > values.capacity())
+                    values.reserve(std::max(values.size() + n, values.capacity() * 2));
+            },
+            [&values] (T v) { values.push_back(v); });
+    }
+
+    return values;
+}
+
+template class hgl::ap::NumericListOption<signed char>;
+template class hgl::ap::NumericListOption<short>;
+template class hgl::ap::NumericListOption<int>;
+template class hgl::ap::NumericListOption<long>;
+template class hgl::ap::NumericListOption<long long>;
+template class hgl::ap::NumericListOption<unsigned char>;
+template class hgl::ap::NumericListOption<unsigned short>;
+template class hgl::ap::NumericListOption<unsigned int>;
+template class hgl::ap::NumericListOption<unsigned long>;
+template class hgl::ap::NumericListOption<unsigned long long>;
+template class hgl::ap::NumericListOption<float>;
+template class hgl::ap::NumericListOption<double>;
+
 void SpecialOption::accept(std::nullptr_t)
 {
-    throw this;
+    this->mark_completed(); // the parser stops after it
+}
+
+bool SpecialOption::get_info(AcceptorInfo & info) const noexcept
+{
+    Option::get_info(info);
+    info.special = true;
+    return true;
 }
@@ -0,0 +1,57 @@
+#include <argparse.h>
+
+#include <algorithm>
+#include <atomic>
+#include <system_error>
+#include <thread>
+
+using namespace hgl::ap;
+
+/// number of argument vectors a thread takes at a time
+static constexpr std::size_t _batch_chunk_size = 16;
+
+std::vector<ParseResult> ArgumentSchema::parse_batch(
+    Span<const ArgVector> argvs, unsigned int n_threads) const
+{
+    std::vector<ParseResult> results(argvs.size());
+
+    if (n_threads == 0)
+        n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const auto n_chunks = (argvs.size() + _batch_chunk_size - 1) / _batch_chunk_size;
+    n_threads = static_cast<unsigned int>(std::min<std::size_t>(n_threads, n_chunks));
+
+    std::atomic<std::size_t> next_index{0};
+
+    // parse() reports every error, out of memory included, in its result
+    auto work = [&] () noexcept {
+        for (;;)
+        {
+            const auto begin = next_index.fetch_add(_batch_chunk_size);
+            if (begin >= argvs.size())
+                break;
+            const auto end = std::min(begin + _batch_chunk_size, argvs.size());
+
+            for (auto i = begin; i < end; i++)
+                this->parse(argvs[i].argc, argvs[i].argv, results[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(n_threads ? n_threads - 1 : 0);
+    for (unsigned int i = 1; i < n_threads; i++)
+    {
+        try
+        {
+            workers.emplace_back(work);
+        }
+        catch (const std::system_error &) // the threads started, and this one, take all chunks
+        {
+            break;
+        }
+    }
+    work();
+    for (auto & t : workers)
+        t.join();
+
+    return results;
+}
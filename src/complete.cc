@@ -0,0 +1,199 @@
+#include <argparse.h>
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+using namespace hgl::ap;
+using namespace std::literals::string_view_literals;
+
+static bool _starts_with(std::string_view text, std::string_view prefix) noexcept
+{
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+bool ArgumentSchema::complete(int argc, const char * argv[], std::ostream & out) const
+{
+    static const char * const no_word[] = {""};
+
+    if (argc < 2 || argv[1] != "--__complete"sv)
+        return false;
+
+    if (argc == 2)
+        this->complete_words({no_word, 1}, out);
+    else
+        this->complete_words({argv + 2, std::size_t(argc - 2)}, out);
+    return true;
+}
+
+/// print candidates for the last word, after walking the others as parse_args() does
+void ArgumentSchema::complete_words(Span<const char * const> words, std::ostream & out) const
+{
+    const std::size_t n_before = words.size() - 1;
+    const std::string_view cur = words[n_before];
+
+    auto print_choices = [&out, cur] (const ArgumentAcceptor * acceptor) {
+        AcceptorInfo info;
+        if (!acceptor->get_info(info))
+            return;
+        for (const std::string_view choice: info.choices)
+        {
+            if (_starts_with(choice, cur))
+                out << choice << '\n';
+        }
+    };
+
+    bool options_ended = false;
+    for (std::size_t k = 0; k < n_before; k++)
+    {
+        const std::string_view word = words[k];
+
+        if (options_ended || word.size() < 2 || word[0] != '-') // text argument or "-"
+        {
+            if (options_ended)
+                continue;
+            if (const Subcommand * const cmd = this->find_subcommand(word))
+            {
+                const ArgumentSchema & sub = this->subcommand_parser(*cmd);
+                sub.complete_words({words.data() + k + 1, words.size() - k - 1}, out);
+                return;
+            }
+            continue;
+        }
+
+        if (word == "--"sv)
+        {
+            options_ended = true;
+            continue;
+        }
+
+        std::uint32_t slot = 0;
+        int n_args = 0;
+        if (word[1] == '-')
+        {
+            if (word.find('=') != word.npos)
+                continue;
+
+            std::uint32_t i = this->long_index.find(word.substr(2));
+            if (i == this->long_index.npos && this->abbreviations_enabled
+                    && this->abbreviate(word.substr(2), i) != 1)
+                i = this->long_index.npos;
+            if (i != this->long_index.npos)
+                slot = this->long_index.slots[i], n_args = this->long_index.arities[i];
+        }
+        else
+        {
+            // an option taking arguments ends the cluster; only the last one takes next words
+            for (std::size_t c = 1; c < word.size(); c++)
+            {
+                const ShortOptEntry & e = this->short_index[static_cast<unsigned char>(word[c])];
+                if (e.slot == UINT32_MAX)
+                    break;
+                if (e.n_args > 0)
+                {
+                    if (c + 1 == word.size())
+                        slot = e.slot, n_args = e.n_args;
+                    break;
+                }
+            }
+        }
+
+        if (n_args > 0)
+        {
+            if (k + std::size_t(n_args) >= n_before) // the last word is an argument of it
+                return print_choices(this->acceptors[slot]);
+            k += std::size_t(n_args);
+        }
+    }
+
+    if (options_ended)
+        return;
+
+    if (cur.empty() || cur[0] != '-')
+    {
+        const auto first = std::lower_bound(this->subcommands.begin(), this->subcommands.end(),
+            cur, [] (const auto & cmd, std::string_view name) { return cmd->name < name; });
+        for (auto it = first; it != this->subcommands.end() && _starts_with((*it)->name, cur); ++it)
+            out << (*it)->name << '\n';
+        return;
+    }
+
+    if (cur.find('=') != cur.npos) // a value attached to an option is not completed
+        return;
+
+    if (cur.size() >= 2 && cur[1] != '-') // "-x"
+    {
+        if (cur.size() == 2 && this->short_index[static_cast<unsigned char>(cur[1])].slot != UINT32_MAX)
+            out << cur << '\n';
+        return;
+    }
+
+    if (cur.size() == 1) // "-"
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            if (this->short_index[c].slot != UINT32_MAX)
+                out << '-' << static_cast<char>(c) << '\n';
+        }
+    }
+
+    const std::string_view prefix = cur.substr(std::min<std::size_t>(cur.size(), 2));
+    const auto & index = this->long_index;
+    const auto first = std::lower_bound(this->long_names.begin(), this->long_names.end(), prefix,
+        [&index] (std::uint32_t i, std::string_view prefix) { return index.name(i) < prefix; });
+    const auto last = std::upper_bound(first, this->long_names.end(), prefix,
+        [&index] (std::string_view prefix, std::uint32_t i) {
+            return prefix < index.name(i).substr(0, prefix.size());
+        });
+    for (auto it = first; it != last; ++it)
+        out << "--" << index.name(*it) << '\n';
+}
+
+std::ostream & ArgumentSchema::print_completion_script(std::ostream & out,
+    CompletionShell shell, std::string_view prog)
+{
+    std::string func("_");
+    for (const char ch: prog)
+        func += std::isalnum(static_cast<unsigned char>(ch)) ? ch : '_';
+    func += "_complete";
+
+    switch (shell)
+    {
+    case CompletionShell::bash:
+        out << "# bash completion for " << prog << "\n"
+            << func << "()\n"
+            << "{\n"
+            << "    local IFS=$'\\n'\n"
+            << "    COMPREPLY=($(" << prog
+            << " --__complete \"${COMP_WORDS[@]:1:COMP_CWORD}\" 2>/dev/null))\n"
+            << "}\n"
+            << "complete -o default -F " << func << ' ' << prog << '\n';
+        break;
+
+    case CompletionShell::zsh:
+        out << "#compdef " << prog << "\n"
+            << func << "()\n"
+            << "{\n"
+            << "    local -a candidates\n"
+            << "    candidates=(${(f)\"$(" << prog
+            << " --__complete \"${(@)words[2,CURRENT]}\" 2>/dev/null)\"})\n"
+            << "    if (( ${#candidates} )); then\n"
+            << "        compadd -a candidates\n"
+            << "    else\n"
+            << "        _files\n"
+            << "    fi\n"
+            << "}\n"
+            << "compdef " << func << ' ' << prog << '\n';
+        break;
+
+    case CompletionShell::fish:
+        out << "# fish completion for " << prog << "\n"
+            << "function " << func << "\n"
+            << "    " << prog << " --__complete (commandline -opc)[2..-1] (commandline -ct) 2>/dev/null\n"
+            << "end\n"
+            << "complete -c " << prog << " -a '(" << func << ")'\n";
+        break;
+    }
+
+    return out;
+}
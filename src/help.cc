@@ -0,0 +1,159 @@
+#include <argparse.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+using namespace hgl::ap;
+
+/// widest left column of help lines; longer names are followed by a line break
+static constexpr std::size_t _help_max_names_width = 25;
+
+void ArgumentParser::layout_help() const
+{
+    struct Line
+    {
+        std::string      names; ///< left column, or the whole text if not laid out
+        std::string_view help;
+        bool             laid_out;
+    };
+
+    std::vector<Line> lines(this->acceptors.size());
+    std::size_t names_width = 0;
+
+    for (std::size_t i = 0; i < lines.size(); i++)
+    {
+        Line & line = lines[i];
+        line.laid_out = this->acceptors[i]->get_helpinfo(line.names, line.help);
+        if (!line.laid_out)
+        {
+            std::ostringstream ss;
+            this->acceptors[i]->print_helpinfo(ss);
+            line.names = ss.str();
+        }
+        else if (line.names.size() <= _help_max_names_width)
+        {
+            names_width = std::max(names_width, line.names.size());
+        }
+    }
+
+    std::string & out = this->help_cache;
+    out.clear();
+
+    out += "Usage: ";
+    out += this->prog_name;
+    out += ' ';
+    for (const ArgumentAcceptor * acceptor: this->acceptors)
+    {
+        acceptor->format_usage(out);
+        out += ' ';
+    }
+    if (!this->subcommands.empty())
+        out += "COMMAND ... ";
+    out += "\n\nOptions:\n";
+
+    for (const Line & line : lines)
+    {
+        if (!line.laid_out)
+        {
+            out += line.names;
+            continue;
+        }
+        if (line.names.empty())
+            continue;
+
+        out += line.names;
+        if (line.names.size() > names_width)
+        {
+            out += '\n';
+            out.append(names_width, ' ');
+        }
+        else
+        {
+            out.append(names_width - line.names.size(), ' ');
+        }
+        out += "  ";
+        out += line.help;
+        out += '\n';
+    }
+
+    if (!this->subcommands.empty())
+    {
+        std::size_t command_width = 0;
+        for (const auto & cmd : this->subcommands)
+            command_width = std::max(command_width, cmd->name.size());
+
+        out += "\nCommands:\n";
+        for (const auto & cmd : this->subcommands)
+        {
+            out += cmd->name;
+            out.append(command_width - cmd->name.size() + 2, ' ');
+            out += cmd->help;
+            out += '\n';
+        }
+    }
+
+    out.shrink_to_fit();
+}
+
+std::string_view ArgumentParser::help_text() const
+{
+    if (this->help_ready.load(std::memory_order_acquire)
+            && this->help_generation.load(std::memory_order_acquire) == this->generation)
+        return this->help_cache;
+
+    std::lock_guard<std::mutex> lock(this->help_mutex);
+
+    if (!(this->help_ready.load(std::memory_order_relaxed)
+            && this->help_generation.load(std::memory_order_relaxed) == this->generation))
+    {
+        this->layout_help();
+        this->help_prog = this->prog_name;
+        this->help_generation.store(this->generation, std::memory_order_release);
+        this->help_ready.store(true, std::memory_order_release);
+    }
+
+    return this->help_cache;
+}
+
+bool ArgumentParser::write_help(int fd) const
+{
+    const std::string_view text = this->help_text();
+
+    for (std::size_t done = 0; done < text.size(); )
+    {
+        const auto n = ::write(fd, text.data() + done, text.size() - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+
+    return true;
+}
+
+std::size_t ArgumentParser::copy_help(char * buffer, std::size_t size) const
+{
+    const std::string_view text = this->help_text();
+
+    if (size)
+    {
+        const auto n = std::min(text.size(), size - 1);
+        std::memcpy(buffer, text.data(), n);
+        buffer[n] = '\0';
+    }
+
+    return text.size();
+}
+
+std::ostream & ArgumentParser::print_help(std::ostream & out) const noexcept
+{
+    const std::string_view text = this->help_text();
+    return out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
@@ -0,0 +1,141 @@
+#include <argparse.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace hgl::ap;
+
+static std::size_t _mapping_size(std::size_t file_size) noexcept
+{
+    const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return (file_size + 1 + page_size - 1) / page_size * page_size;
+}
+
+/**
+ * @brief read a file that cannot be mapped (e.g. a pipe) into anonymous memory
+ *
+ * @param[out] file_size bytes read
+ * @return memory laid out as open() maps files, or nullptr (errno is set)
+ */
+static char * _read_unmappable(int fd, std::size_t & file_size) noexcept
+{
+    std::size_t capacity = _mapping_size(0) * 4, size = 0;
+    void * base = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return nullptr;
+
+    for (;;)
+    {
+        if (size + 1 == capacity) // keep a '\0' after the content
+        {
+            void * const larger = ::mmap(nullptr, capacity * 2,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (larger == MAP_FAILED)
+                break;
+            std::memcpy(larger, base, size);
+            ::munmap(base, capacity);
+            base = larger, capacity *= 2;
+        }
+
+        const auto n = ::read(fd, static_cast<char *>(base) + size, capacity - 1 - size);
+        if (n > 0)
+            size += static_cast<std::size_t>(n);
+        else if (n == 0)
+        {
+            // release the pages that close() will not know of
+            const auto map_size = _mapping_size(size);
+            if (map_size < capacity)
+                ::munmap(static_cast<char *>(base) + map_size, capacity - map_size);
+            file_size = size;
+            return static_cast<char *>(base);
+        }
+        else if (errno != EINTR)
+            break;
+    }
+
+    const int error = errno;
+    ::munmap(base, capacity);
+    errno = error;
+    return nullptr;
+}
+
+bool MappedFile::open(const char * path) noexcept
+{
+    this->close();
+
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (!S_ISREG(st.st_mode))
+    {
+        std::size_t file_size = 0;
+        char * const data = _read_unmappable(fd, file_size);
+        const int error = errno;
+        ::close(fd);
+        if (data == nullptr)
+        {
+            errno = error;
+            return false;
+        }
+
+        this->addr = data;
+        this->length = file_size;
+        return true;
+    }
+
+    const auto file_size = static_cast<std::size_t>(st.st_size);
+    const auto map_size = _mapping_size(file_size);
+
+    // Reserve one more byte than the file with anonymous memory, then map the
+    // file over it, so that the byte after the end of file is always
+    // accessible, even if the file size is a multiple of page size.
+    void * const base = ::mmap(nullptr, map_size,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    if (file_size)
+    {
+        void * const p = ::mmap(base, file_size,
+            PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            ::munmap(base, map_size);
+            ::close(fd);
+            return false;
+        }
+        ::madvise(base, file_size, MADV_SEQUENTIAL);
+    }
+
+    ::close(fd);
+
+    this->addr = static_cast<char *>(base);
+    this->length = file_size;
+    return true;
+}
+
+void MappedFile::close() noexcept
+{
+    if (this->addr == nullptr)
+        return;
+
+    ::munmap(this->addr, _mapping_size(this->length));
+    this->addr = nullptr;
+    this->length = 0;
+}
@@ -1,348 +1,1997 @@
 #include <argparse.h>
+#include "profile.h"
 
+#include <algorithm>
+#ifdef __cpp_lib_bitops
+#   include <bit>
+#endif
 #include <cassert>
-#include <cstdarg>
-#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <new>
 #include <stdexcept>
+#include <utility>
+#ifdef __SSE2__
+#   include <emmintrin.h>
+#endif
+
+extern "C" char ** environ;
+
+using namespace hgl::ap;
+using namespace std::literals::string_view_literals;
+
+std::string ParseStatus::message(Span<const char * const> args) const
+{
+    if (this->ok())
+        return {};
+    return ArgumentParseError(*this, args).what();
+}
+
+const char * ArgumentParseError::what() const noexcept
+{
+    const ParseStatus & st = this->parse_status;
+    if (!this->msg.empty() || st.code == ParseErrorCode::other)
+        return this->msg.c_str();
+
+    try
+    {
+        HGL_AP_SCOPE(phase, format, st.acceptor);
+
+        std::string & msg = this->msg;
+        std::string name;
+        if (st.acceptor)
+            st.acceptor->get_name(name);
+
+        auto quote = [&msg] (std::string_view token, std::string_view after) {
+            msg.append(1, '"').append(token).append("\": ").append(after);
+        };
+        auto at_line = [&msg, &st] (std::string_view after) {
+            msg.append(st.text).append(1, ':').append(std::to_string(st.detail)).append(": ").append(after);
+        };
+
+        switch (st.code)
+        {
+        case ParseErrorCode::ok:
+        case ParseErrorCode::special:
+        case ParseErrorCode::other:
+            break;
+
+        case ParseErrorCode::unknown_option:
+            quote(this->token_text, "unknown option: "), msg += st.text;
+            break;
+
+        case ParseErrorCode::duplicated_option:
+            quote(this->token_text, "duplicated option: "), msg += st.text;
+            break;
+
+        case ParseErrorCode::unexpected_argument:
+            quote(this->token_text, "unexpected argument");
+            break;
+
+        case ParseErrorCode::unexpected_value:
+            quote(this->token_text, "option "), msg.append(name).append(" consumes 0 argument but 1 is given");
+            break;
+
+        case ParseErrorCode::value_count:
+            quote(this->token_text, "option ");
+            msg.append(name).append(" consumes ").append(std::to_string(st.detail)).append(" argument but 1 is given");
+            break;
+
+        case ParseErrorCode::too_few_arguments:
+            msg.append("too few arguments for option ").append(name);
+            break;
+
+        case ParseErrorCode::missing_required:
+            msg.append("no enough arguments for ");
+            if (st.text.empty())
+                msg += name;
+            else
+                msg += st.text;
+            break;
+
+        case ParseErrorCode::bad_response_file:
+            quote('@' + std::string(st.text), "cannot read response file: "), msg += std::strerror(st.detail);
+            break;
+
+        case ParseErrorCode::response_file_depth:
+            quote('@' + std::string(st.text), "response files nested too deeply");
+            break;
+
+        case ParseErrorCode::out_of_memory:
+            msg += "out of memory";
+            break;
+
+        case ParseErrorCode::unclosed_quote:
+            quote('@' + std::string(st.text), "quote not closed");
+            break;
+
+        case ParseErrorCode::bad_config_file:
+            quote(st.text, "cannot read config file: "), msg += std::strerror(st.detail);
+            break;
+
+        case ParseErrorCode::bad_config_line:
+            if (st.acceptor)
+                at_line("option "), msg.append(name).append(" takes more than one argument");
+            else
+                at_line("expected \"key = value\" or \"[section]\"");
+            break;
+
+        case ParseErrorCode::unknown_config_key:
+            at_line("unknown option");
+            break;
+
+        case ParseErrorCode::unknown_subcommand:
+            quote(this->token_text, "unknown command");
+            break;
+
+        case ParseErrorCode::bad_subcommand:
+            quote(this->token_text, "cannot set up command");
+            break;
+
+        case ParseErrorCode::ambiguous_option:
+            quote(this->token_text, "ambiguous option: ");
+            msg.append(st.text).append(" matches ").append(std::to_string(st.detail))
+                .append(" options, e.g. ").append(name);
+            break;
+
+        case ParseErrorCode::bad_arguments:
+            msg.append("bad arguments for ").append(name).append(": ");
+            if (st.detail == 1)
+                msg += st.text;
+            for (const char * arg: this->args)
+                msg += arg;
+            break;
+
+        case ParseErrorCode::bad_value:
+        case ParseErrorCode::value_out_of_range:
+            msg.append(this->reason ? this->reason : "bad value: ").append(st.text);
+            break;
+
+        case ParseErrorCode::bad_choice:
+            msg.append("not a valid choice: ").append(st.text).append(" (expected ");
+            for (std::size_t i = 0; i < this->choices.size(); i++)
+            {
+                if (i != 0)
+                    msg += ", ";
+                msg += this->choices[i];
+            }
+            msg += ')';
+            break;
+        }
+    }
+    catch (...) // out of memory
+    {
+        this->msg.clear();
+        return "argument parse error";
+    }
+
+    return this->msg.c_str();
+}
+
+void ArgumentSchema::chech_health()
+{
+}
+
+namespace
+{
+    /// parse state of an acceptor
+    enum : std::uint8_t
+    {
+        _st_longopt    = 1 << 0, ///< accepting arg with long option name
+        _st_shortopt   = 1 << 1, ///< accepting arg with short option name
+        _st_restarg    = 1 << 2, ///< accepting arg with no option name
+        _st_completed  = 1 << 3,
+        _st_repeatable = 1 << 4, ///< keeps accepting after accepted
+        _st_special    = 1 << 5, ///< parsing stops after accepted
+    };
+
+    constexpr std::uint32_t _no_slot = UINT32_MAX;
+}
+
+static bool _test_bit(const std::uint64_t * bits, std::uint32_t slot) noexcept
+{
+    return bits[slot / 64] & (std::uint64_t(1) << (slot % 64));
+}
+
+static void _set_bit(std::uint64_t * bits, std::uint32_t slot) noexcept
+{
+    bits[slot / 64] |= std::uint64_t(1) << (slot % 64);
+}
+
+static void _clear_bit(std::uint64_t * bits, std::uint32_t slot) noexcept
+{
+    bits[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+}
+
+/// whether an error is thrown by an acceptor, whose message needs more than the status
+static bool _is_thrown(ParseErrorCode code) noexcept
+{
+    return code >= ParseErrorCode::bad_arguments && code <= ParseErrorCode::other;
+}
+
+/// index of the lowest bit set in `bits`, which is not 0
+static std::uint32_t _lowest_bit(std::uint64_t bits) noexcept
+{
+#ifdef __cpp_lib_bitops
+    return static_cast<std::uint32_t>(std::countr_zero(bits));
+#else
+    return static_cast<std::uint32_t>(__builtin_ctzll(bits));
+#endif
+}
+
+/// parse mode that calls ArgumentAcceptor::accept()
+struct ArgumentSchema::Accepting
+{
+    std::uint64_t  * given = nullptr; ///< per acceptor bits, set when accepted but not from config file
+    std::uint64_t  * done = nullptr;  ///< per acceptor bits, set when completed by accepting
+    std::uint8_t   * states = nullptr; ///< per acceptor state, updated after each accept
+    MappedFile     * config = nullptr;
+    ArgumentParser * parser = nullptr;
+    const ArgumentAcceptor * special = nullptr; ///< special acceptor accepted, which stops parsing
+
+    MappedFile & config_file() const noexcept { return *this->config; }
+
+    /// state read from the flags of an acceptor
+    static std::uint8_t state_of(const ArgumentAcceptor * aa) noexcept
+    {
+        return (aa->accepting_longopt ? _st_longopt : 0)
+            | (aa->accepting_shortopt ? _st_shortopt : 0)
+            | (aa->accepting_restarg ? _st_restarg : 0)
+            | (aa->completed ? _st_completed : 0);
+    }
+
+    /// matching reads the mirrored state, so that unmatched acceptors are not touched
+    std::uint8_t state(std::uint32_t slot) const noexcept { return this->states[slot]; }
+
+    void update_state(const ArgumentAcceptor * aa, std::uint32_t slot) noexcept
+    {
+        auto & st = this->states[slot];
+        st = (st & (_st_repeatable | _st_special)) | state_of(aa);
+        if (st & _st_special)
+            this->special = aa;
+    }
+
+    int probe(ArgumentAcceptor * aa, std::string_view long_opt) const noexcept
+    {
+        HGL_AP_COUNT(aa, probes);
+        const bool fc = aa->completed, fa = aa->accepting_longopt;
+        aa->completed = false, aa->accepting_longopt = true;
+        const int r = aa->acceptable(long_opt);
+        aa->completed = fc, aa->accepting_longopt = fa;
+        return r;
+    }
+
+    /// the acceptor tracks its own text arguments
+    int probe_restarg(ArgumentAcceptor * aa, int) const noexcept
+    {
+        HGL_AP_COUNT(aa, probes);
+        return aa->acceptable(nullptr);
+    }
+
+    int probe(ArgumentAcceptor * aa, char short_opt) const noexcept
+    {
+        HGL_AP_COUNT(aa, probes);
+        const bool fc = aa->completed, fa = aa->accepting_shortopt;
+        aa->completed = false, aa->accepting_shortopt = true;
+        const int r = aa->acceptable(short_opt);
+        aa->completed = fc, aa->accepting_shortopt = fa;
+        return r;
+    }
+
+    void reset(ArgumentAcceptor * aa, std::uint32_t slot, std::uint8_t st) noexcept
+    {
+        this->states[slot] = st;
+        aa->accepting_longopt = st & _st_longopt;
+        aa->accepting_shortopt = st & _st_shortopt;
+        aa->accepting_restarg = st & _st_restarg;
+        aa->completed = st & _st_completed;
+    }
+
+    const ArgumentAcceptor * stopped() const noexcept { return this->special; }
+
+    bool is_given(std::uint32_t slot) const noexcept { return _test_bit(this->given, slot); }
+
+    const std::uint64_t * completed() const noexcept { return this->done; }
+
+    std::string & missing_names() const noexcept { return this->parser->missing_names; }
+
+    void mark_given(const ArgumentAcceptor * aa, std::uint32_t slot) noexcept
+    {
+        this->update_state(aa, slot);
+        _set_bit(this->given, slot);
+        if (aa->completed)
+            _set_bit(this->done, slot);
+    }
+
+    /// call `f`, which converts arguments for `aa`, recording where errors it throws occurred
+    template <typename F>
+    static void converting(const ArgumentAcceptor * aa, std::size_t token, F && f)
+    {
+        try
+        {
+            f();
+        }
+        catch (ArgumentParseError & e)
+        {
+            e.locate(token, aa);
+            throw;
+        }
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, std::nullptr_t)
+    {
+        HGL_AP_SCOPE(phase, convert, aa);
+        HGL_AP_COUNT(aa, conversions);
+        converting(aa, token, [=] { aa->accept(name, nullptr); });
+        this->mark_given(aa, slot);
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, std::string_view value)
+    {
+        HGL_AP_SCOPE(phase, convert, aa);
+        HGL_AP_COUNT(aa, conversions);
+        converting(aa, token, [=] { aa->accept(name, value); });
+        this->mark_given(aa, slot);
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, int n, const char ** args, std::string_view)
+    {
+        HGL_AP_SCOPE(phase, convert, aa);
+        HGL_AP_COUNT(aa, conversions);
+        converting(aa, token, [=] { aa->accept(name, n, args); });
+        this->mark_given(aa, slot);
+    }
+
+    /// accept a value that is not from the arguments
+    template <typename Value>
+    void accept_from(ArgSource source, ArgumentAcceptor * aa, std::uint32_t slot,
+        std::size_t token, std::string_view name, Value value)
+    {
+        HGL_AP_SCOPE(phase, convert, aa);
+        HGL_AP_COUNT(aa, conversions);
+        converting(aa, token, [=] { aa->accept(name, value); });
+        if (source != ArgSource::config_file) // a later line of the file may override it
+            this->mark_given(aa, slot);
+        else if (this->update_state(aa, slot), aa->completed)
+            _set_bit(this->done, slot);
+    }
+
+    /// drop what an earlier line of the config file gave to `aa`
+    void forget(ArgumentAcceptor * aa, std::uint32_t slot, std::uint8_t st) noexcept
+    {
+        this->reset(aa, slot, st);
+        _clear_bit(this->done, slot);
+        aa->begin_parse(this->parser->arena);
+    }
+
+    /// parse the tokens after the current one with the subcommand parser
+    template <typename Tokens>
+    ParseStatus run_subcommand(const ArgumentSchema & schema, const Subcommand & cmd,
+        const Tokens & tokens)
+    {
+        ArgumentParser & sub = schema.subcommand_parser(cmd);
+        this->parser->selected = &cmd;
+        auto rest = tokens.rest(sub.expanded_args);
+        try
+        {
+            return sub.accept_tokens(rest); // errors of acceptors go to the top parser
+        }
+        catch (ArgumentParseError & e)
+        {
+            e.locate(e.parse_status.token + tokens.index(), nullptr);
+            throw;
+        }
+    }
+};
+
+/// parse mode that records into a ParseResult
+struct ArgumentSchema::Recording
+{
+    ParseResult & result;
+
+    MappedFile & config_file() const noexcept { return this->result.config; }
+
+    std::uint8_t state(std::uint32_t slot) const noexcept
+    {
+        return this->result.state[slot];
+    }
+
+    template <typename Name>
+    int probe(ArgumentAcceptor * aa, Name name) const noexcept
+    {
+        HGL_AP_COUNT(aa, probes);
+        return aa->acceptable(name);
+    }
+
+    /// flags of the acceptor belong to ArgumentParser, so the arity is taken from the index
+    int probe_restarg(ArgumentAcceptor * aa, int indexed) const noexcept
+    {
+        HGL_AP_COUNT(aa, probes);
+        return indexed;
+    }
+
+    const ArgumentAcceptor * stopped() const noexcept { return this->result.special_acceptor; }
+
+    bool is_given(std::uint32_t slot) const noexcept
+    {
+        const auto & r = this->result;
+        return _test_bit(r.present.data(), slot)
+            && r.occurrence_list[r.last[slot]].source != ArgSource::config_file;
+    }
+
+    /// an acceptor is completed once recorded
+    const std::uint64_t * completed() const noexcept { return this->result.present.data(); }
+
+    std::string & missing_names() const
+    {
+        auto & names = this->result.missing_names;
+        if (!names)
+            names = std::make_unique<std::string>();
+        return *names;
+    }
+
+    void record(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token, ArgSource source,
+        std::string_view name, std::string_view value, const char * const * args, int n)
+    {
+        auto & r = this->result;
+
+        r.last[slot] = static_cast<std::uint32_t>(r.occurrence_list.size());
+        _set_bit(r.present.data(), slot);
+        r.occurrence_list.push_back({aa, token, name, value, args, n, source});
+
+        auto & st = r.state[slot];
+        if (st & _st_special)
+            r.special_acceptor = aa;
+        st = (st & _st_repeatable) ? st | _st_completed : _st_completed;
+    }
+
+    ArgSource source_of(std::size_t token) const noexcept
+    {
+        const auto & sources = this->result.expanded_sources;
+        return sources.empty() ? ArgSource::command_line : sources[token];
+    }
+
+    /// convert a value as `aa` would, keeping nothing, recording where errors it throws occurred
+    static void check(ArgumentAcceptor * aa, std::size_t token, std::string_view value)
+    {
+        HGL_AP_SCOPE(phase, convert, aa);
+        HGL_AP_COUNT(aa, conversions);
+        Accepting::converting(aa, token, [=] { aa->check(value); });
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, std::nullptr_t)
+    {
+        this->record(aa, slot, token, this->source_of(token), name, {}, nullptr, 0);
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, std::string_view value)
+    {
+        check(aa, token, value);
+        this->record(aa, slot, token, this->source_of(token), name, value, nullptr, 1);
+    }
+
+    void accept(ArgumentAcceptor * aa, std::uint32_t slot, std::size_t token,
+        std::string_view name, int n, const char ** args, std::string_view first_arg)
+    {
+        if (n == 1)
+            check(aa, token, first_arg);
+        this->record(aa, slot, token, this->source_of(token), name, first_arg, args, n);
+    }
+
+    /// accept a value that is not from the arguments
+    void accept_from(ArgSource source, ArgumentAcceptor * aa, std::uint32_t slot,
+        std::size_t token, std::string_view name, std::nullptr_t)
+    {
+        this->record(aa, slot, token, source, name, {}, nullptr, 0);
+    }
+
+    /// @see accept_from(ArgSource, ArgumentAcceptor *, std::uint32_t, std::size_t, std::string_view, std::nullptr_t)
+    void accept_from(ArgSource source, ArgumentAcceptor * aa, std::uint32_t slot,
+        std::size_t token, std::string_view name, std::string_view value)
+    {
+        check(aa, token, value);
+        this->record(aa, slot, token, source, name, value, nullptr, 1);
+    }
+
+    /// drop the occurrence an earlier line of the config file gave to `aa`
+    void forget(ArgumentAcceptor * aa, std::uint32_t slot, std::uint8_t st) noexcept
+    {
+        auto & r = this->result;
+        const auto index = r.last[slot];
+        r.occurrence_list.erase(r.occurrence_list.begin() + index);
+        for (auto & last : r.last)
+        {
+            if (last != ParseResult::no_occurrence && last > index)
+                last--;
+        }
+
+        r.last[slot] = ParseResult::no_occurrence;
+        _clear_bit(r.present.data(), slot);
+        r.state[slot] = st;
+        if (r.special_acceptor == aa)
+            r.special_acceptor = nullptr;
+    }
+
+    /// parse the tokens after the current one with the subcommand parser
+    template <typename Tokens>
+    ParseStatus run_subcommand(const ArgumentSchema & schema, const Subcommand & cmd,
+        const Tokens & tokens) noexcept
+    {
+        auto & r = this->result;
+        r.command = cmd.name;
+
+        const ArgumentSchema * sub;
+        try
+        {
+            if (!r.command_result)
+                r.command_result = std::make_unique<ParseResult>();
+            sub = &schema.subcommand_parser(cmd); // may create it
+        }
+        catch (...)
+        {
+            return {ParseErrorCode::bad_subcommand, 0, 0, nullptr, cmd.name}; // token of the command
+        }
+
+        Span<const ArgSource> sources;
+        if (!r.expanded_sources.empty())
+            sources = {r.expanded_sources.data() + tokens.index(), r.expanded_sources.size() - tokens.index()};
+
+        auto rest = tokens.rest(r.command_result->expanded_args);
+        const auto status = sub->parse_tokens(rest, *r.command_result, sources);
+        if (_is_thrown(status.code))
+            r.value_error = r.command_result->value_error; // for the message of this result
+        return status;
+    }
+};
+
+/// FNV-1a hash of a name
+static std::uint32_t _hash_name(std::string_view name) noexcept
+{
+    std::uint32_t h = 2166136261u;
+    for (const char ch: name)
+        h = (h ^ static_cast<unsigned char>(ch)) * 16777619u;
+    return h;
+}
+
+void ArgumentSchema::LongNameTable::clear() noexcept
+{
+    this->pool.clear();
+    this->offsets.clear();
+    this->lengths.clear();
+    this->hashes.clear();
+    this->slots.clear();
+    this->arities.clear();
+    this->buckets.clear();
+}
+
+void ArgumentSchema::LongNameTable::rehash(std::size_t n_buckets)
+{
+    assert((n_buckets & (n_buckets - 1)) == 0);
+
+    this->buckets.assign(n_buckets, {0, 0});
+    const std::size_t mask = n_buckets - 1;
+    for (std::uint32_t i = 0; i < this->size(); i++)
+    {
+        std::size_t b = this->hashes[i] & mask;
+        while (this->buckets[b].name != 0)
+            b = (b + 1) & mask;
+        this->buckets[b] = {this->hashes[i], i + 1};
+    }
+}
+
+void ArgumentSchema::LongNameTable::insert(std::string_view name, std::uint32_t slot, int n_args)
+{
+    if (this->find(name) != npos)
+        return;
+
+    // at most half full, so that probe sequences stay short
+    if ((this->size() + 1) * 2 > this->buckets.size())
+        this->rehash(this->buckets.empty() ? 16 : this->buckets.size() * 2);
+
+    const std::uint32_t i = this->size();
+    const std::uint32_t hash = _hash_name(name);
+    this->offsets.push_back(static_cast<std::uint32_t>(this->pool.size()));
+    this->lengths.push_back(static_cast<std::uint32_t>(name.size()));
+    this->hashes.push_back(hash);
+    this->slots.push_back(slot);
+    this->arities.push_back(n_args);
+    this->pool += name;
+
+    const std::size_t mask = this->buckets.size() - 1;
+    std::size_t b = hash & mask;
+    while (this->buckets[b].name != 0)
+        b = (b + 1) & mask;
+    this->buckets[b] = {hash, i + 1};
+}
+
+std::uint32_t ArgumentSchema::LongNameTable::find(std::string_view name) const noexcept
+{
+    if (this->buckets.empty())
+        return npos;
+
+    const std::uint32_t hash = _hash_name(name);
+    const std::size_t mask = this->buckets.size() - 1;
+    for (std::size_t b = hash & mask; this->buckets[b].name != 0; b = (b + 1) & mask)
+    {
+        const Bucket & bucket = this->buckets[b];
+        if (bucket.hash == hash && this->name(bucket.name - 1) == name)
+            return bucket.name - 1;
+    }
+
+    return npos;
+}
+
+void ArgumentSchema::set_acceptors(
+    ArgumentAcceptor * const * begin, ArgumentAcceptor * const * end)
+{
+    this->acceptors.assign(begin, end);
+    this->build_index();
+}
+
+void ArgumentSchema::build_index()
+{
+    this->long_index.clear();
+    this->slots.clear();
+    this->unindexed.clear();
+    this->restarg_arity.assign(this->acceptors.size(), -1);
+    this->name_pool.clear();
+    this->env_index.clear();
+    this->initial_state.clear();
+    this->required_mask.assign((this->acceptors.size() + 63) / 64, 0);
+    this->generation++;
+    for (auto & e : this->short_index)
+        e = {_no_slot, 0};
+
+    this->slots.reserve(this->acceptors.size());
+    this->initial_state.reserve(this->acceptors.size());
+
+    for (std::uint32_t slot = 0; slot < this->acceptors.size(); slot++)
+    {
+        ArgumentAcceptor * const acceptor = this->acceptors[slot];
+
+        this->slots.emplace(acceptor, slot);
+        this->initial_state.push_back(Accepting::state_of(acceptor));
+        if (!(this->initial_state.back() & _st_completed))
+            _set_bit(this->required_mask.data(), slot);
+
+        AcceptorInfo info;
+        if (!acceptor->get_info(info))
+        {
+            this->unindexed.push_back(slot);
+            this->restarg_arity[slot] = acceptor->acceptable(nullptr);
+            continue;
+        }
+
+        if (info.repeatable)
+            this->initial_state.back() |= _st_repeatable;
+        if (info.special)
+            this->initial_state.back() |= _st_special;
+
+        // the first acceptor of a name wins, as a linear scan does
+        if (!info.long_opt.empty())
+        {
+            this->long_index.insert(info.long_opt, slot, info.n_args);
+
+            if (info.negatable)
+            {
+                std::string name("no-");
+                name += info.long_opt;
+                this->long_index.insert(name, slot, info.n_args);
+            }
+        }
+
+        if (info.short_opt != '\0')
+        {
+            auto & e = this->short_index[static_cast<unsigned char>(info.short_opt)];
+            if (e.slot == _no_slot)
+                e = {slot, info.n_args};
+        }
+
+        if (info.env)
+        {
+            std::string_view env_var = info.env_var;
+            if (env_var.empty())
+            {
+                auto & name = this->name_pool.emplace_back(this->env_prefix);
+                std::string suffix;
+                acceptor->get_name(suffix);
+                name += suffix;
+                env_var = name;
+            }
+
+            std::string_view opt_name = info.long_opt;
+            if (opt_name.empty())
+                opt_name = this->name_pool.emplace_back(1, info.short_opt);
+
+            this->env_index.emplace(env_var, EnvEntry{slot, info.n_args, opt_name});
+        }
+    }
+
+    this->build_long_names();
+}
+
+void ArgumentSchema::build_long_names()
+{
+    const auto & index = this->long_index;
+    this->long_names.resize(index.size());
+    for (std::uint32_t i = 0; i < index.size(); i++)
+        this->long_names[i] = i;
+    std::sort(this->long_names.begin(), this->long_names.end(),
+        [&index] (std::uint32_t a, std::uint32_t b) { return index.name(a) < index.name(b); });
+}
+
+void ArgumentSchema::enable_abbreviations(bool enabled)
+{
+    this->abbreviations_enabled = enabled;
+}
+
+void ArgumentSchema::set_env_prefix(std::string_view prefix)
+{
+    this->env_prefix = prefix;
+    this->build_index();
+}
+
+void ArgumentSchema::set_config_file(std::string_view path, bool required)
+{
+    this->config_path = path;
+    this->config_required = required;
+}
+
+void ArgumentSchema::add_subcommand(std::string_view name, SubcommandFactory factory,
+    const char * help)
+{
+    if (name.empty())
+        throw std::invalid_argument("empty subcommand name");
+
+    const auto pos = std::lower_bound(this->subcommands.begin(), this->subcommands.end(), name,
+        [] (const auto & cmd, std::string_view name) { return cmd->name < name; });
+    if (pos != this->subcommands.end() && (*pos)->name == name)
+        throw std::invalid_argument("duplicated subcommand name");
+
+    auto cmd = std::make_unique<Subcommand>();
+    cmd->name = name;
+    cmd->factory = factory;
+    cmd->help = help == nullptr ? "" : help;
+    this->subcommands.insert(pos, std::move(cmd));
+    this->generation++;
+}
+
+const ArgumentSchema::Subcommand *
+ArgumentSchema::find_subcommand(std::string_view name) const noexcept
+{
+    const auto pos = std::lower_bound(this->subcommands.begin(), this->subcommands.end(), name,
+        [] (const auto & cmd, std::string_view name) { return cmd->name < name; });
+    return pos != this->subcommands.end() && (*pos)->name == name ? pos->get() : nullptr;
+}
+
+ArgumentParser & ArgumentSchema::subcommand_parser(const Subcommand & cmd) const
+{
+    std::call_once(cmd.built, [&cmd] { cmd.parser = cmd.factory(); });
+    assert(cmd.parser);
+    return *cmd.parser;
+}
+
+/// report all required acceptors that have not completed, by one mask test per 64
+template <typename Mode>
+ParseStatus ArgumentSchema::check_required(const Mode & mode, std::size_t token) const
+{
+    const std::uint64_t * const completed = mode.completed();
+
+    std::uint32_t first = _no_slot;
+    int n_missing = 0;
+    for (std::uint32_t w = 0; w < this->required_mask.size(); w++)
+    {
+        for (auto bits = this->required_mask[w] & ~completed[w]; bits; bits &= bits - 1)
+        {
+            const auto slot = w * 64 + _lowest_bit(bits);
+            std::string & names = mode.missing_names();
+            if (n_missing++ == 0)
+                first = slot, names.clear();
+            else
+                names += ", ";
+
+            std::string name;
+            this->acceptors[slot]->get_name(name);
+            names += name;
+        }
+    }
+
+    if (n_missing == 0)
+        return {};
+    return {ParseErrorCode::missing_required, n_missing, token,
+        this->acceptors[first], mode.missing_names()};
+}
+
+/**
+ * @brief find long option names that begin with a prefix
+ *
+ * @param prefix the prefix
+ * @param[out] name index in long_index of the first name found
+ * @return number of names found
+ */
+std::size_t ArgumentSchema::abbreviate(std::string_view prefix, std::uint32_t & name) const noexcept
+{
+    const auto & index = this->long_index;
+    const auto first = std::lower_bound(this->long_names.begin(), this->long_names.end(), prefix,
+        [&index] (std::uint32_t i, std::string_view prefix) { return index.name(i) < prefix; });
+    const auto last = std::upper_bound(first, this->long_names.end(), prefix,
+        [&index] (std::string_view prefix, std::uint32_t i) {
+            return prefix < index.name(i).substr(0, prefix.size());
+        });
+
+    if (first != last)
+        name = *first;
+    return static_cast<std::size_t>(last - first);
+}
+
+/// `long_opt` is replaced by the full name if abbreviated
+template <typename Mode> ArgumentAcceptor * ArgumentSchema::match(
+    const Mode & mode, std::string_view & long_opt, int & n, std::uint32_t & slot) const
+{
+    const auto & index = this->long_index;
+    if (const auto i = index.find(long_opt); i != index.npos)
+    {
+        n = index.arities[i], slot = index.slots[i];
+        HGL_AP_COUNT(this->acceptors[slot], lookups);
+        return (mode.state(slot) & _st_longopt) ? this->acceptors[slot] : nullptr;
+    }
+    HGL_AP_COUNT(nullptr, lookups);
+
+    for (const auto i: this->unindexed)
+    {
+        if (!(mode.state(i) & _st_longopt))
+            continue;
+
+        ArgumentAcceptor * const acceptor = this->acceptors[i];
+        HGL_AP_COUNT(acceptor, probes);
+        if ((n = acceptor->acceptable(long_opt)) >= 0)
+            return slot = i, acceptor;
+    }
+
+    std::uint32_t i;
+    if (this->abbreviations_enabled && !long_opt.empty() && this->abbreviate(long_opt, i) == 1)
+    {
+        long_opt = index.name(i);
+        n = index.arities[i], slot = index.slots[i];
+        HGL_AP_COUNT(this->acceptors[slot], lookups);
+        return (mode.state(slot) & _st_longopt) ? this->acceptors[slot] : nullptr;
+    }
+
+    return nullptr;
+}
+
+template <typename Mode> ArgumentAcceptor * ArgumentSchema::match(
+    const Mode & mode, char short_opt, int & n, std::uint32_t & slot) const
+{
+    const ShortOptEntry & entry = this->short_index[static_cast<unsigned char>(short_opt)];
+    if (entry.slot != _no_slot)
+    {
+        n = entry.n_args, slot = entry.slot;
+        HGL_AP_COUNT(this->acceptors[slot], lookups);
+        return (mode.state(slot) & _st_shortopt) ? this->acceptors[slot] : nullptr;
+    }
+    HGL_AP_COUNT(nullptr, lookups);
+
+    for (const auto i: this->unindexed)
+    {
+        if (!(mode.state(i) & _st_shortopt))
+            continue;
+
+        ArgumentAcceptor * const acceptor = this->acceptors[i];
+        HGL_AP_COUNT(acceptor, probes);
+        if ((n = acceptor->acceptable(short_opt)) >= 0)
+            return slot = i, acceptor;
+    }
+
+    return nullptr;
+}
+
+/**
+ * @brief whether an unmatched option name belongs to an acceptor that has accepted
+ *
+ * @param slot slot of the acceptor whose name is indexed, or _no_slot
+ */
+template <typename Mode, typename Name>
+bool ArgumentSchema::is_duplicated(const Mode & mode, std::uint32_t slot, Name optname) const
+{
+    if (slot != _no_slot)
+        return _test_bit(mode.completed(), slot);
+
+    for (const auto i: this->unindexed)
+    {
+        if (mode.probe(this->acceptors[i], optname) >= 0)
+            return true;
+    }
+
+    return false;
+}
+
+static constexpr int _max_response_file_depth = 32;
+
+static bool _is_response_file_arg(const char * arg) noexcept
+{
+    return arg[0] == '@' && arg[1] != '\0';
+}
+
+/**
+ * @brief split next argument from response file content in place
+ *
+ * @param[in,out] p current position, moved to after the argument
+ * @param end end of content, where a '\0' can be written
+ * @param[out] unclosed set if the argument ends in a quote
+ * @return NUL-terminated argument, or nullptr if no more
+ */
+static const char * _next_response_file_arg(char *& p, char * end, bool & unclosed) noexcept
+{
+    while (p != end && std::isspace(static_cast<unsigned char>(*p)))
+        ++p;
+    if (p == end)
+        return nullptr;
+
+    char * const arg = p;
+    char * out = p;
+    char quote = '\0';
+
+    for (; p != end; ++p)
+    {
+        const char ch = *p;
+
+        if (quote != '\0')
+        {
+            if (ch == quote)
+                quote = '\0';
+            else if (ch == '\\' && quote == '"' && p + 1 != end)
+                *out++ = *++p;
+            else
+                *out++ = ch;
+        }
+        else if (std::isspace(static_cast<unsigned char>(ch)))
+        {
+            ++p;
+            break;
+        }
+        else if (ch == '\'' || ch == '"')
+            quote = ch;
+        else if (ch == '\\' && p + 1 != end)
+            *out++ = *++p;
+        else
+            *out++ = ch;
+    }
+
+    *out = '\0'; // out <= end
+    unclosed = quote != '\0';
+    return arg;
+}
+
+static ParseStatus _expand_response_file(const char * path, int depth,
+    std::list<MappedFile> & files, std::vector<const char *> & args,
+    std::vector<ArgSource> * sources)
+{
+    if (depth >= _max_response_file_depth)
+        return {ParseErrorCode::response_file_depth, 0, 0, nullptr, path};
+
+    MappedFile & file = files.emplace_back();
+    if (!file.open(path))
+        return {ParseErrorCode::bad_response_file, errno, 0, nullptr, path};
+
+    char * p = file.data();
+    char * const end = p + file.size();
+
+    bool unclosed = false;
+    while (const char * arg = _next_response_file_arg(p, end, unclosed))
+    {
+        if (unclosed)
+            return {ParseErrorCode::unclosed_quote, 0, 0, nullptr, path};
+
+        if (_is_response_file_arg(arg))
+        {
+            const auto status = _expand_response_file(arg + 1, depth + 1, files, args, sources);
+            if (!status.ok())
+                return status;
+        }
+        else
+        {
+            args.push_back(arg);
+            if (sources)
+                sources->push_back(ArgSource::response_file);
+        }
+    }
+
+    return {};
+}
+
+/**
+ * @brief expand "@file" arguments
+ *
+ * @param[in,out] argc number of arguments, updated if expanded
+ * @param[in,out] argv argument vector, replaced with `args` if expanded
+ * @param[out] files mapped response files
+ * @param[out] args storage of expanded arguments
+ * @param[out] sources sources of expanded arguments (optional)
+ * @return error status, with `token` indexing the original `argv`
+ */
+static ParseStatus _expand_response_files(int & argc, const char **& argv,
+    std::list<MappedFile> & files, std::vector<const char *> & args,
+    std::vector<ArgSource> * sources = nullptr)
+{
+    files.clear();
+
+    const char ** const argv_end = argv + argc;
+    const char ** iter = argc ? argv + 1 : argv_end;
+
+    for (; iter != argv_end && std::strcmp(*iter, "--") != 0; ++iter)
+    {
+        if (_is_response_file_arg(*iter))
+            break;
+    }
+
+    if (iter == argv_end || **iter != '@')
+        return {};
+
+    args.assign(argv, iter);
+    if (sources)
+        sources->assign(args.size(), ArgSource::command_line);
+
+    for (; iter != argv_end; ++iter)
+    {
+        if (std::strcmp(*iter, "--") == 0)
+        {
+            args.insert(args.end(), iter, argv_end);
+            break;
+        }
+
+        if (_is_response_file_arg(*iter))
+        {
+            auto status = _expand_response_file(*iter + 1, 0, files, args, sources);
+            if (!status.ok())
+            {
+                status.token = iter - argv;
+                return status;
+            }
+        }
+        else
+        {
+            args.push_back(*iter);
+            if (sources)
+                sources->push_back(ArgSource::command_line);
+        }
+    }
 
-using namespace hgl::ap;
-using namespace std::literals::string_view_literals;
+    if (sources)
+        sources->resize(args.size(), ArgSource::command_line);
 
-static constexpr auto _strbuf_size = 256;
-static thread_local char _strbug[_strbuf_size];
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+    return {};
+}
 
-[[noreturn]] static void _throw_parse_error(const char * fmt, ...)
+static std::string_view _prog_name(std::string_view name) noexcept
 {
-    std::va_list ap;
-
-    va_start(ap, fmt);
-    std::vsnprintf(_strbug, _strbuf_size, fmt, ap);
-    va_end(ap);
+    const auto slash_pos = name.rfind('/');
+    if (slash_pos != name.npos)
+        name.remove_prefix(slash_pos + 1);
+    return name;
+}
 
-    throw ArgumentParseError(_strbug);
+static TokenKind _token_kind(const char * token, std::size_t length) noexcept
+{
+    if (length == 0 || token[0] != '-')
+        return TokenKind::positional;
+    if (length == 1)
+        return TokenKind::dash;
+    if (token[1] != '-')
+        return TokenKind::short_options;
+    return length == 2 ? TokenKind::terminator : TokenKind::long_option;
 }
 
-[[noreturn]] static void _throw_std_invalid_argument(const char * fmt, ...)
+/**
+ * @brief measure a NUL-terminated token in one pass
+ *
+ * With SSE2, the '\0' and the first '=' are searched 16 bytes at a time by
+ * aligned loads, which may read past the '\0' but never across a page.
+ */
+#if defined(__SSE2__) && defined(__GNUC__)
+__attribute__((no_sanitize_address))
+#endif
+static TokenInfo _measure_token(const char * token) noexcept
 {
-    std::va_list ap;
+    std::size_t length, equal_pos;
+#ifdef __SSE2__
+    const auto addr = reinterpret_cast<std::uintptr_t>(token);
+    const char * p = reinterpret_cast<const char *>(addr & ~std::uintptr_t(15));
+    const __m128i nul = _mm_setzero_si128();
+    const __m128i equal = _mm_set1_epi8('=');
 
-    va_start(ap, fmt);
-    std::vsnprintf(_strbug, _strbuf_size, fmt, ap);
-    va_end(ap);
+    std::uint32_t skip = addr & 15; // bytes before the token in the first block
+    std::uint32_t equal_bits = 0;
+    for (;; p += 16, skip = 0)
+    {
+        const __m128i block = _mm_load_si128(reinterpret_cast<const __m128i *>(p));
+        const auto nul_bits = std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(block, nul))) >> skip << skip;
+        if (equal_bits == 0)
+        {
+            equal_bits = std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(block, equal))) >> skip << skip;
+            if (nul_bits != 0)
+                equal_bits &= (nul_bits & -nul_bits) - 1; // before the '\0'
+            if (equal_bits != 0)
+                equal_pos = std::size_t(p - token) + _lowest_bit(equal_bits);
+        }
+        if (nul_bits != 0)
+        {
+            length = std::size_t(p - token) + _lowest_bit(nul_bits);
+            break;
+        }
+    }
+    if (equal_bits == 0)
+        equal_pos = length;
+#else
+    length = std::strlen(token);
+    const void * const equal = std::memchr(token, '=', length);
+    equal_pos = equal ? std::size_t(static_cast<const char *>(equal) - token) : length;
+#endif
 
-    throw std::invalid_argument(_strbug);
+    return {static_cast<std::uint32_t>(length), static_cast<std::uint32_t>(equal_pos),
+        _token_kind(token, length)};
 }
 
-[[noreturn]] static void _throw_0a_req_1a_given(
-    const char * text, const ArgumentAcceptor * opt)
+/// tokens of an argument vector
+struct ArgumentSchema::ArgvTokens
+{
+    const char      ** argv;
+    std::size_t        n;
+    std::size_t        i = 0; ///< index of current token
+    const TokenInfo  * infos = nullptr; ///< per token, once measured
+
+    ArgvTokens(const char ** argv, std::size_t n, const TokenInfo * infos = nullptr) noexcept:
+        argv(argv), n(n), infos(infos) {}
+
+    /// measure all tokens into `table`, unless they have been
+    void measure(std::vector<TokenInfo> & table)
+    {
+        if (this->infos)
+            return;
+
+        table.resize(this->n);
+        for (std::size_t k = 0; k < this->n; k++)
+            table[k] = _measure_token(this->argv[k]);
+        this->infos = table.data();
+    }
+
+    bool done() const noexcept { return this->i >= this->n; }
+    const TokenInfo & info() const noexcept { return this->infos[this->i]; }
+    std::string_view get() const noexcept { return {this->argv[this->i], this->info().length}; }
+    void next() noexcept { if (this->i < this->n) ++this->i; }
+    std::size_t index() const noexcept { return this->i; }
+    std::size_t size() const noexcept { return this->n; }
+    Span<const char * const> args() const noexcept { return {this->argv, this->n}; }
+
+    /**
+     * @brief take `count` arguments from current token, none of which is an option
+     *
+     * @param[out] first_arg the first argument
+     * @return the arguments, with current token moved to the last one;
+     *  nullptr if there are not enough
+     */
+    const char ** take(int count, std::string_view & first_arg) noexcept
+    {
+        if (this->n - this->i < std::size_t(count))
+            return nullptr;
+
+        for (int k = 0; k < count; k++)
+        {
+            if (this->infos[this->i + k].kind != TokenKind::positional)
+                return nullptr;
+        }
+
+        first_arg = this->get();
+        const char ** const args = this->argv + this->i;
+        this->i += count - 1;
+        return args;
+    }
+
+    /// tokens from current one on, measured already
+    ArgvTokens rest(std::vector<const char*> &) const noexcept
+    {
+        return {this->argv + this->i, this->n - this->i, this->infos + this->i};
+    }
+
+    void attach(ParseResult & result) const noexcept
+    {
+        result.arg_vec = this->argv;
+        result.n_args = this->n;
+    }
+
+    /// @see _expand_response_files()
+    ParseStatus expand_response_files(std::list<MappedFile> & files,
+        std::vector<const char *> & args, std::vector<ArgSource> * sources = nullptr)
+    {
+        int argc = static_cast<int>(this->n);
+        const char ** const argv = this->argv;
+        const auto status = _expand_response_files(argc, this->argv, files, args, sources);
+        this->n = static_cast<std::size_t>(argc);
+        if (this->argv != argv)
+            this->infos = nullptr; // to be measured again
+        return status;
+    }
+};
+
+/// tokens of a NUL-separated buffer, walked in place
+struct ArgumentSchema::BlobTokens
+{
+    const char  * data;
+    const char  * cur;  ///< current token
+    const char  * end;
+    TokenInfo     cur_info; ///< of current token
+    std::size_t   i = 0;
+    std::vector<const char*> & storage; ///< arguments given by take()
+    bool          reserved = false;
+
+    BlobTokens(const char * data, std::size_t size, std::vector<const char*> & storage):
+        data(data), cur(data), end(data + size), storage(storage)
+    {
+        assert(size == 0 || data[size - 1] == '\0');
+        this->storage.clear();
+        this->cur_info = this->measure_current();
+    }
+
+    TokenInfo measure_current() const noexcept
+    {
+        if (this->cur == this->end)
+            return {0, 0, TokenKind::positional};
+        return _measure_token(this->cur);
+    }
+
+    /// tokens are measured as they are walked
+    void measure(std::vector<TokenInfo> &) const noexcept {}
+
+    bool done() const noexcept { return this->cur == this->end; }
+    const TokenInfo & info() const noexcept { return this->cur_info; }
+    std::string_view get() const noexcept { return {this->cur, this->cur_info.length}; }
+    std::size_t index() const noexcept { return this->i; }
+
+    void next() noexcept
+    {
+        if (this->cur == this->end)
+            return;
+        this->cur += this->cur_info.length + 1;
+        this->cur_info = this->measure_current();
+        ++this->i;
+    }
+
+    /// number of all tokens, counted on demand from current one
+    std::size_t size() const noexcept
+    {
+        return this->i + std::count(this->cur, this->end, '\0');
+    }
+
+    /// @see ArgvTokens::take()
+    const char ** take(int count, std::string_view & first_arg)
+    {
+        // the storage holds at most one pointer per token, and never moves once reserved
+        if (!this->reserved)
+        {
+            this->storage.reserve(this->storage.size() + (this->size() - this->i));
+            this->reserved = true;
+        }
+
+        const auto first = this->storage.size();
+        for (int k = 0; k < count; k++)
+        {
+            if (k != 0)
+                this->next();
+            if (this->done() || this->cur_info.kind != TokenKind::positional)
+            {
+                this->storage.resize(first);
+                return nullptr;
+            }
+            if (k == 0)
+                first_arg = this->get();
+            this->storage.push_back(this->cur);
+        }
+
+        return this->storage.data() + first;
+    }
+
+    /// tokens from current one on, whose arguments go to `storage`
+    BlobTokens rest(std::vector<const char*> & storage) const
+    {
+        return {this->cur, std::size_t(this->end - this->cur), storage};
+    }
+
+    void attach(ParseResult & result) const noexcept
+    {
+        result.cmdline = {this->data, std::size_t(this->end - this->data)};
+    }
+
+    /// response files are not expanded in a blob
+    ParseStatus expand_response_files(std::list<MappedFile> &,
+        std::vector<const char *> &, std::vector<ArgSource> * = nullptr) noexcept
+    {
+        return {};
+    }
+};
+
+/// pointers to the tokens of a blob, to quote them in messages
+static std::vector<const char *> _split_cmdline(std::string_view blob)
 {
-    std::string buffer;
-    opt->get_name(buffer);
-    _throw_parse_error("\"%s\": option %s consumes 0 argument "
-        "but 1 is given", text, buffer.c_str());
+    std::vector<const char *> args;
+    for (std::size_t pos = 0; pos < blob.size(); pos = blob.find('\0', pos) + 1)
+        args.push_back(blob.data() + pos);
+    return args;
 }
 
-[[noreturn]] static void _throw_na_req_1a_given(
-    const char * text, int req_n, const ArgumentAcceptor * opt)
+template <typename Tokens>
+ParseStatus ArgumentParser::run(Tokens & tokens) noexcept
 {
-    std::string buffer;
-    opt->get_name(buffer);
-    _throw_parse_error("\"%s\": option %s consumes %i argument "
-        "but 1 is given", text, buffer.c_str(), req_n);
+    this->failure = nullptr;
+    try
+    {
+        return this->accept_tokens(tokens);
+    }
+    catch (const ArgumentParseError & e) // a value cannot be converted
+    {
+        this->failure = std::current_exception();
+        return e.status();
+    }
+    catch (const std::bad_alloc &)
+    {
+        return {ParseErrorCode::out_of_memory, 0, 0, nullptr, {}};
+    }
+    catch (...) // thrown by an acceptor, but not about a value
+    {
+        this->failure = std::current_exception();
+        return {ParseErrorCode::other, 0, 0, nullptr, {}};
+    }
 }
 
-[[noreturn]] static void _throw_unknown_opt(const char * text, std::string_view opt)
+template <typename Tokens>
+ParseStatus ArgumentParser::accept_tokens(Tokens & tokens)
 {
-    std::string buffer(opt);
-    _throw_parse_error("\"%s\": unknown option: %s", text, buffer.c_str());
+    HGL_AP_SCOPE(parse, parse, nullptr);
+    HGL_AP_SCOPE(phase, tokenize, nullptr);
+
+    this->selected = nullptr;
+
+    if (this->response_files_enabled)
+    {
+        const auto status = tokens.expand_response_files(
+            this->response_files, this->expanded_args);
+        if (!status.ok())
+            return status;
+    }
+
+    tokens.measure(this->token_info);
+    if (tokens.done())
+        return {};
+
+    this->prog_name = _prog_name(tokens.get());
+    if (this->prog_name != this->help_prog)
+        this->help_ready.store(false, std::memory_order_relaxed);
+
+    this->arena.reset();
+    this->given.assign((this->acceptors.size() + 63) / 64, 0);
+    this->completed.assign(this->given.size(), 0);
+
+    Accepting mode;
+    mode.given = this->given.data();
+    mode.done = this->completed.data();
+    this->state.resize(this->acceptors.size());
+    mode.states = this->state.data();
+    mode.config = &this->config;
+    mode.parser = this;
+    for (std::uint32_t slot = 0; slot < this->acceptors.size(); slot++)
+    {
+        HGL_AP_SCOPE(phase, tokenize, this->acceptors[slot]);
+        HGL_AP_COUNT(this->acceptors[slot], calls);
+        mode.reset(this->acceptors[slot], slot, this->initial_state[slot]);
+        this->acceptors[slot]->begin_parse(this->arena);
+    }
+
+    HGL_AP_LEAVE(phase);
+    return this->parse_args(mode, tokens);
 }
 
-[[noreturn]] static void _throw_duplicated_opt(const char * text, std::string_view opt)
+/// throw what ended a parse, as the throwing entry points always have
+void ArgumentParser::raise(const ParseStatus & status, Span<const char * const> args)
 {
-    std::string buffer(opt);
-    _throw_parse_error("\"%s\": duplicated option: %s", text, buffer.c_str());
+    if (this->failure)
+        std::rethrow_exception(std::exchange(this->failure, nullptr));
+
+    if (status.code == ParseErrorCode::special)
+    {
+        // acceptors are given to the parser as non-const
+        if (const auto special = dynamic_cast<const SpecialOption *>(status.acceptor))
+            throw const_cast<SpecialOption *>(special);
+        return;
+    }
+
+    if (!status.ok())
+        throw ArgumentParseError(status, args);
 }
 
-[[noreturn]] static void _throw_unexpected_arg(const char * text)
+ParseStatus ArgumentParser::try_parse(int argc, const char * argv[]) noexcept
 {
-    _throw_parse_error("\"%s\": unexpected argument", text);
+    ArgvTokens tokens(argv, std::size_t(argc));
+    return this->run(tokens);
 }
 
-[[noreturn]] static void _throw_too_many_args(const ArgumentAcceptor * aa)
+void ArgumentParser::operator()(int argc, const char * argv[])
 {
-    std::string name;
-    aa->get_name(name);
-    _throw_parse_error("too may arguments for option %s", name.c_str());
+    ArgvTokens tokens(argv, std::size_t(argc));
+    const auto status = this->run(tokens);
+    this->raise(status, tokens.args());
 }
 
-[[noreturn]] static void _throw_too_few_args(const ArgumentAcceptor * aa)
+void ArgumentParser::parse_cmdline(const char * data, std::size_t size)
 {
-    std::string name;
-    aa->get_name(name);
-    _throw_parse_error("too few arguments for option %s", name.c_str());
+    BlobTokens tokens(data, size, this->expanded_args);
+    const auto status = this->run(tokens);
+    if (status.code != ParseErrorCode::ok)
+    {
+        const auto args = _split_cmdline({data, size});
+        this->raise(status, args);
+    }
 }
 
-void ArgumentParser::chech_health()
+void ArgumentParser::validate() const
 {
+    for (const ArgumentAcceptor * acceptor: this->acceptors)
+        acceptor->validate();
+
+    if (this->selected)
+        this->selected->parser->validate();
 }
 
-bool ArgumentParser::is_duplicated(int type, std::string_view optname)
+template <typename Tokens>
+ParseStatus ArgumentSchema::parse_tokens(Tokens & tokens, ParseResult & result,
+    Span<const ArgSource> sources) const noexcept
 {
-    if (type == 1)
+    try
     {
-        for (ArgumentAcceptor * acceptor: acceptors)
+        HGL_AP_SCOPE(parse, parse, nullptr);
+        HGL_AP_SCOPE(phase, tokenize, nullptr);
+
+        result.reset(*this);
+        tokens.attach(result);
+
+        if (this->response_files_enabled)
         {
-            const bool fc = acceptor->completed, fa = acceptor->accepting_shortopt;
-            acceptor->completed = false, acceptor->accepting_shortopt = true;
-            const bool r = acceptor->acceptable(optname.front()) >= 0;
-            acceptor->completed = fc, acceptor->accepting_shortopt = fa;
-            if (r) return true;
+            result.parse_status = tokens.expand_response_files(result.response_files,
+                result.expanded_args, &result.expanded_sources);
+            if (!result.parse_status.ok())
+                return result.parse_status;
+
+            tokens.attach(result);
         }
+        if (result.expanded_sources.empty() && !sources.empty())
+            result.expanded_sources.assign(sources.begin(), sources.end());
+
+        tokens.measure(result.token_info);
+        if (tokens.done())
+            return result.parse_status;
+
+        result.prog = _prog_name(tokens.get());
+
+        HGL_AP_LEAVE(phase);
+        Recording mode{result};
+        result.parse_status = this->parse_args(mode, tokens);
     }
-    else if (type == 2)
+    catch (ArgumentParseError & e) // a value cannot be converted
     {
-        for (ArgumentAcceptor * acceptor: acceptors)
-        {
-            const bool fc = acceptor->completed, fa = acceptor->accepting_longopt;
-            acceptor->completed = false, acceptor->accepting_longopt = true;
-            const bool r = acceptor->acceptable(optname) >= 0;
-            acceptor->completed = fc, acceptor->accepting_longopt = fa;
-            if (r) return true;
-        }
+        result.value_error = std::move(e);
+        result.parse_status = result.value_error.status();
     }
-    else
+    catch (const std::bad_alloc &)
     {
-        assert(false);
+        result.parse_status = {ParseErrorCode::out_of_memory, 0, 0, nullptr, {}};
     }
+    catch (...) // thrown by an acceptor, but not about a value
+    {
+        result.parse_status = {ParseErrorCode::other, 0, 0, nullptr, {}};
+    }
+    return result.parse_status;
+}
 
-    return false;
+ParseStatus ArgumentSchema::parse(
+    int argc, const char * argv[], ParseResult & result) const noexcept
+{
+    ArgvTokens tokens(argv, std::size_t(argc));
+    return this->parse_tokens(tokens, result);
 }
 
-void ArgumentParser::operator()(int argc, const char * argv[])
+ParseResult ArgumentSchema::parse(int argc, const char * argv[]) const
 {
-    using arg_t = const char *;
+    ParseResult result;
+    this->parse(argc, argv, result);
+    return result;
+}
 
-    if (argc == 0)
-        return;
+ParseStatus ArgumentSchema::parse_cmdline(const char * data, std::size_t size,
+    ParseResult & result) const noexcept
+{
+    BlobTokens tokens(data, size, result.expanded_args);
+    return this->parse_tokens(tokens, result);
+}
+
+static std::string_view _trim_config_text(std::string_view text) noexcept
+{
+    constexpr auto spaces = " \t\r\f\v"sv;
 
+    const auto first = text.find_first_not_of(spaces);
+    if (first == text.npos)
+        return text.substr(text.size()); // keeps pointing into the text
+    return text.substr(first, text.find_last_not_of(spaces) - first + 1);
+}
+
+/// whether a value from environment or config file turns on an option that takes no argument
+static bool _flag_value(std::string_view value) noexcept
+{
+    return !(value.empty() || value == "0"sv || value == "false"sv
+        || value == "no"sv || value == "off"sv);
+}
+
+template <typename Mode>
+ParseStatus ArgumentSchema::parse_config(Mode & mode, MappedFile & file, std::size_t token) const
+{
+    if (!file.open(this->config_path.c_str()))
+    {
+        if (errno == ENOENT && !this->config_required)
+            return {};
+        return {ParseErrorCode::bad_config_file, errno, 0, nullptr, this->config_path};
+    }
+
+    char * p = file.data();
+    char * const end = p + file.size();
+    std::string_view section;
+    std::string key_buffer;
+    std::vector<std::uint64_t> from_file((this->acceptors.size() + 63) / 64); ///< per acceptor bits
+
+    for (int line = 1; p < end; line++)
     {
-        this->prog_name = argv[0];
-        const auto slash_pos = this->prog_name.find('/');
-        if (slash_pos != this->prog_name.npos)
-            this->prog_name.remove_prefix(slash_pos + 1);
+        auto * eol = static_cast<char *>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end;
+        char * const line_begin = p;
+        p = eol == end ? end : eol + 1;
+
+        const auto text = _trim_config_text({line_begin, std::size_t(eol - line_begin)});
+        if (text.empty() || text.front() == '#' || text.front() == ';')
+            continue;
+
+        if (text.front() == '[')
+        {
+            if (text.back() != ']')
+                return {ParseErrorCode::bad_config_line, line, 0, nullptr, this->config_path};
+            section = _trim_config_text(text.substr(1, text.size() - 2));
+            continue;
+        }
+
+        const auto equal_pos = text.find('=');
+        const auto key = _trim_config_text(text.substr(0, equal_pos));
+        if (equal_pos == text.npos || key.empty())
+            return {ParseErrorCode::bad_config_line, line, 0, nullptr, this->config_path};
+
+        auto value = _trim_config_text(text.substr(equal_pos + 1));
+        if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'')
+                && value.back() == value.front())
+            value = value.substr(1, value.size() - 2);
+        line_begin[value.data() + value.size() - line_begin] = '\0'; // for C string users
+
+        std::string_view name = key;
+        if (!section.empty())
+        {
+            key_buffer.assign(section);
+            key_buffer += '-';
+            key_buffer += key;
+            name = key_buffer;
+        }
+
+        // keys in sections are only matched through the index, which has stable names
+        ArgumentAcceptor * acceptor = nullptr;
+        std::uint32_t slot = 0;
+        int n = -1;
+        if (const auto i = this->long_index.find(name); i != this->long_index.npos)
+        {
+            name = this->long_index.name(i), slot = this->long_index.slots[i];
+            n = this->long_index.arities[i];
+            acceptor = this->acceptors[slot];
+            HGL_AP_COUNT(acceptor, lookups);
+        }
+        else if (section.empty())
+        {
+            for (const auto i: this->unindexed)
+            {
+                if ((n = mode.probe(this->acceptors[i], name)) >= 0)
+                {
+                    acceptor = this->acceptors[i], slot = i;
+                    break;
+                }
+            }
+        }
+
+        if (acceptor == nullptr || n < 0)
+            return {ParseErrorCode::unknown_config_key, line, 0, nullptr, this->config_path};
+        if (n > 1)
+            return {ParseErrorCode::bad_config_line, line, 0, acceptor, this->config_path};
+
+        if (mode.is_given(slot))
+            continue;
+
+        // the last line wins, for lists too
+        if (_test_bit(from_file.data(), slot))
+            mode.forget(acceptor, slot, this->initial_state[slot]);
+        _set_bit(from_file.data(), slot);
+
+        if (n == 0)
+        {
+            if (_flag_value(value))
+                mode.accept_from(ArgSource::config_file, acceptor, slot, token, name, nullptr);
+        }
+        else
+        {
+            mode.accept_from(ArgSource::config_file, acceptor, slot, token, name, value);
+        }
     }
 
-    arg_t * iter = argv + 1;
-    const arg_t * iter_end = argv + argc;
+    return {};
+}
+
+template <typename Mode, typename Tokens>
+ParseStatus ArgumentSchema::parse_args(Mode & mode, Tokens & tokens) const
+{
     std::string_view cur_opt, value;
+    std::size_t token = 0; // index of the token being parsed
+    const Subcommand * command = nullptr;
 
-    auto accept_args = [&] (ArgumentAcceptor * acceptor, int n_args) {
+    HGL_AP_SCOPE(phase, match, nullptr);
+
+    auto fail = [&] (ParseErrorCode code, const ArgumentAcceptor * acceptor,
+            std::string_view text = {}, int detail = 0) -> ParseStatus {
+        return {code, detail, token, acceptor, text};
+    };
+
+    auto accept_args = [&] (ArgumentAcceptor * acceptor, std::uint32_t slot, int n_args) {
         assert(n_args >= 1);
 
-        const char ** args_begin = iter;
+        const std::size_t first = tokens.index();
+        std::string_view first_arg;
+        const char ** const args = tokens.take(n_args, first_arg);
+        if (args == nullptr)
+            return false;
+
+        mode.accept(acceptor, slot, first, cur_opt, n_args, args, first_arg);
+        return true;
+    };
+
+    // returns the acceptor that failed to take enough arguments, or nullptr
+    auto accept_restarg = [&] (bool & accepted) -> ArgumentAcceptor * {
+        accepted = false;
 
-        --iter;
-        for (int i = 0; i < n_args; i++)
+        for (const auto slot: this->unindexed)
         {
-            ++iter;
+            if (!(mode.state(slot) & _st_restarg))
+                continue;
+            ArgumentAcceptor * const acceptor = this->acceptors[slot];
 
-            if (iter == iter_end || **iter == '-')
-                _throw_too_few_args(acceptor);
+            const auto n = mode.probe_restarg(acceptor, this->restarg_arity[slot]);
+            assert(n > 0);
+
+            cur_opt = {};
+            accepted = true;
+            return accept_args(acceptor, slot, n) ? nullptr : acceptor;
         }
 
-        acceptor->accept(cur_opt, n_args, args_begin);
+        return nullptr;
     };
 
-    for (; iter < iter_end; ++iter)
+    for (tokens.next(); !tokens.done(); tokens.next()) // after program name
     {
-        cur_opt = *iter;
+        token = tokens.index();
 
-        if (cur_opt == "--"sv)
-        {
-            for (++iter; iter != iter_end; ++iter)
-            {
-                for (ArgumentAcceptor * acceptor: this->acceptors)
-                {
-                    if (!acceptor->accepting_restarg)
-                        continue;
+        if (const auto special = mode.stopped())
+            return fail(ParseErrorCode::special, special);
 
-                    auto n = acceptor->acceptable(nullptr);
-                    assert(n > 0);
+        cur_opt = tokens.get();
+        const TokenInfo info = tokens.info();
 
-                    accept_args(acceptor, n);
+        if (info.kind == TokenKind::terminator)
+        {
+            for (tokens.next(); !tokens.done(); tokens.next())
+            {
+                token = tokens.index();
 
-                    goto _NEXT_LOOP;
-                }
+                bool accepted;
+                if (const auto acceptor = accept_restarg(accepted))
+                    return fail(ParseErrorCode::too_few_arguments, acceptor);
+                if (accepted)
+                    break;
             }
         }
-        else if (cur_opt == "-"sv)
+        else if (info.kind == TokenKind::dash)
         {
-            for (ArgumentAcceptor * acceptor: this->acceptors)
+            for (const auto slot: this->unindexed)
             {
-                if (!(acceptor->accepting_restarg && acceptor->acceptable(nullptr) == 1))
+                if (!(mode.state(slot) & _st_restarg))
+                    continue;
+                ArgumentAcceptor * const acceptor = this->acceptors[slot];
+
+                if (mode.probe_restarg(acceptor, this->restarg_arity[slot]) != 1)
                     continue;
 
-                acceptor->accept(cur_opt, cur_opt);
+                mode.accept(acceptor, slot, token, {}, cur_opt);
 
                 goto _NEXT_LOOP;
             }
 
-            _throw_unexpected_arg(*iter);
+            return fail(ParseErrorCode::unexpected_argument, nullptr, cur_opt);
         }
-#ifdef __cpp_lib_starts_ends_with
-        else if (cur_opt.starts_with("--"sv))
-#else
-        else if (cur_opt.substr(0, 2) == "--"sv)
-#endif
+        else if (info.kind == TokenKind::long_option)
         {
             cur_opt.remove_prefix(2);
 
-            const auto equal_pos = cur_opt.find('=');
+            const auto equal_pos = info.equal_pos < info.length ? info.equal_pos - 2 : cur_opt.npos;
             if (equal_pos != cur_opt.npos) // e.g. "xxx=yyy"
             {
                 value = cur_opt.substr(equal_pos + 1); // "yyy"
                 cur_opt.remove_suffix(value.size() + 1); // "xxx"
             }
 
-            for (ArgumentAcceptor * acceptor: this->acceptors)
+            int n;
+            std::uint32_t slot = _no_slot;
+            if (ArgumentAcceptor * acceptor = this->match(mode, cur_opt, n, slot))
             {
-                if (!acceptor->accepting_longopt)
-                    continue;
-
-                const auto n = acceptor->acceptable(cur_opt);
-                if (n < 0)
-                    continue;
-
                 if (n == 0)
                 {
                     if (equal_pos != cur_opt.npos)
-                        _throw_0a_req_1a_given(*iter, acceptor);
+                        return fail(ParseErrorCode::unexpected_value, acceptor, cur_opt);
 
-                    acceptor->accept(cur_opt, nullptr);
+                    mode.accept(acceptor, slot, token, cur_opt, nullptr);
                 }
                 else
                 {
                     if (equal_pos != cur_opt.npos)
                     {
                         if (n != 1)
-                            _throw_na_req_1a_given(*iter, n, acceptor);
+                            return fail(ParseErrorCode::value_count, acceptor, cur_opt, n);
 
-                        acceptor->accept(cur_opt, value);
+                        mode.accept(acceptor, slot, token, cur_opt, value);
                     }
                     else
                     {
-                        ++iter;
-                        accept_args(acceptor, n);
+                        tokens.next();
+                        if (!accept_args(acceptor, slot, n))
+                            return fail(ParseErrorCode::too_few_arguments, acceptor, cur_opt, n);
                     }
                 }
 
                 goto _NEXT_LOOP;
             }
 
-            this->is_duplicated(2, cur_opt) ?
-                _throw_duplicated_opt(*iter, cur_opt):
-                _throw_unknown_opt(*iter, cur_opt);
+            // a name that was found, in full or abbreviated, is a duplicate rather than ambiguous
+            if (slot == _no_slot && this->abbreviations_enabled && !cur_opt.empty())
+            {
+                std::uint32_t name;
+                if (const auto count = this->abbreviate(cur_opt, name); count > 1)
+                {
+                    return fail(ParseErrorCode::ambiguous_option,
+                        this->acceptors[this->long_index.slots[name]],
+                        cur_opt, static_cast<int>(count));
+                }
+            }
+
+            return this->is_duplicated(mode, slot, cur_opt) ?
+                fail(ParseErrorCode::duplicated_option, nullptr, cur_opt):
+                fail(ParseErrorCode::unknown_option, nullptr, cur_opt);
         }
-#ifdef __cpp_lib_starts_ends_with
-        else if (cur_opt.starts_with('-'))
-#else
-        else if (!cur_opt.empty() && cur_opt.front() == '-')
-#endif
+        else if (info.kind == TokenKind::short_options)
         {
-            cur_opt.remove_prefix(1);
+            // e.g. "-f", "-fZZZ" (attached value), "-abc" (clustered options)
+            const std::string_view cluster = cur_opt.substr(1);
 
-            const bool has_value = cur_opt.length() > 1;
-            if (has_value) // e.g. "-fZZZ"
+            for (std::size_t i = 0; i < cluster.size(); i++)
             {
-                value = cur_opt.substr(1); // "ZZZ"
-                cur_opt.remove_suffix(value.size()); // "f"
-            }
+                if (const auto special = mode.stopped())
+                    return fail(ParseErrorCode::special, special);
 
-            for (ArgumentAcceptor * acceptor: this->acceptors)
-            {
-                if (!acceptor->accepting_shortopt)
-                    continue;
+                cur_opt = cluster.substr(i, 1); // "f"
+                value = cluster.substr(i + 1); // "ZZZ"
 
-                const auto n = acceptor->acceptable(cur_opt.front());
-                if (n < 0)
-                    continue;
+                int n;
+                std::uint32_t slot = _no_slot;
+                ArgumentAcceptor * const acceptor = this->match(mode, cur_opt.front(), n, slot);
+                if (acceptor == nullptr)
+                {
+                    return this->is_duplicated(mode, slot, cur_opt.front()) ?
+                        fail(ParseErrorCode::duplicated_option, nullptr, cur_opt):
+                        fail(ParseErrorCode::unknown_option, nullptr, cur_opt);
+                }
 
                 if (n == 0)
                 {
-                    if (has_value)
-                        _throw_0a_req_1a_given(*iter, acceptor);
+                    mode.accept(acceptor, slot, token, cur_opt, nullptr);
+                    continue; // following chars are options
+                }
+
+                if (!value.empty())
+                {
+                    if (n != 1)
+                        return fail(ParseErrorCode::value_count, acceptor, cur_opt, n);
 
-                    acceptor->accept(cur_opt, nullptr);
+                    mode.accept(acceptor, slot, token, cur_opt, value);
                 }
                 else
                 {
-                    if (has_value)
-                    {
-                        if (n != 1)
-                            _throw_na_req_1a_given(*iter, n, acceptor);
-
-                        acceptor->accept(cur_opt, value);
-                    }
-                    else
-                    {
-                        ++iter;
-                        accept_args(acceptor, n);
-                    }
+                    tokens.next();
+                    if (!accept_args(acceptor, slot, n))
+                        return fail(ParseErrorCode::too_few_arguments, acceptor, cur_opt, n);
                 }
 
-                goto _NEXT_LOOP;
+                break;
             }
-
-            this->is_duplicated(1, cur_opt) ?
-                _throw_duplicated_opt(*iter, cur_opt):
-                _throw_unknown_opt(*iter, cur_opt);
         }
         else
         {
-            for (ArgumentAcceptor * acceptor: this->acceptors)
+            if (!this->subcommands.empty())
             {
-                if (!acceptor->accepting_restarg)
-                    continue;
-
-                const auto n = acceptor->acceptable(nullptr);
-                assert(n > 0);
-
-                accept_args(acceptor, n);
-
-                goto _NEXT_LOOP;
+                if ((command = this->find_subcommand(cur_opt)))
+                    break; // the rest belongs to the subcommand
             }
 
-            _throw_unexpected_arg(*iter);
+            bool accepted;
+            if (const auto acceptor = accept_restarg(accepted))
+                return fail(ParseErrorCode::too_few_arguments, acceptor);
+            if (!accepted)
+            {
+                return fail(this->subcommands.empty() ? ParseErrorCode::unexpected_argument :
+                    ParseErrorCode::unknown_subcommand, nullptr, cur_opt);
+            }
         }
 
     _NEXT_LOOP:;
     }
 
-    for (ArgumentAcceptor * acceptor: this->acceptors)
+    const std::size_t n_tokens = tokens.size();
+
+    if (const auto special = mode.stopped())
+        return {ParseErrorCode::special, 0, n_tokens, special, {}};
+
+    if (!this->env_index.empty())
     {
-        if (!acceptor->completed)
+        // one pass over the environment; arguments take precedence
+        for (char ** env = environ; *env; ++env)
         {
-            std::string name;
-            acceptor->get_name(name);
-            _throw_parse_error("no enough arguments for %s", name.c_str());
+            const std::string_view entry = *env;
+            const auto equal_pos = entry.find('=');
+            if (equal_pos == entry.npos)
+                continue;
+
+            const auto it = this->env_index.find(entry.substr(0, equal_pos));
+            if (it == this->env_index.end())
+                continue;
+
+            HGL_AP_COUNT(this->acceptors[it->second.slot], lookups);
+            if (mode.is_given(it->second.slot))
+                continue;
+
+            const EnvEntry & e = it->second;
+            ArgumentAcceptor * const acceptor = this->acceptors[e.slot];
+            value = entry.substr(equal_pos + 1);
+
+            if (e.n_args == 0)
+            {
+                if (_flag_value(value))
+                    mode.accept_from(ArgSource::environment, acceptor, e.slot, n_tokens, e.opt_name, nullptr);
+            }
+            else
+            {
+                mode.accept_from(ArgSource::environment, acceptor, e.slot, n_tokens, e.opt_name, value);
+            }
         }
+
+        if (const auto special = mode.stopped())
+            return {ParseErrorCode::special, 0, n_tokens, special, {}};
+    }
+
+    if (!this->config_path.empty())
+    {
+        auto status = this->parse_config(mode, mode.config_file(), n_tokens);
+        status.token = n_tokens;
+        if (!status.ok())
+            return status;
+
+        if (const auto special = mode.stopped())
+            return {ParseErrorCode::special, 0, n_tokens, special, {}};
+    }
+
+    HGL_AP_SWITCH(phase, required);
+    if (const auto status = this->check_required(mode, n_tokens); !status.ok())
+        return status;
+
+    HGL_AP_LEAVE(phase);
+    if (command)
+    {
+        const auto offset = tokens.index();
+        auto status = mode.run_subcommand(*this, *command, tokens);
+        if (status.code != ParseErrorCode::ok)
+            status.token += offset;
+        return status;
     }
+
+    return {};
+}
+
+
+const ParseResult::Occurrence * ParseResult::find(const ArgumentAcceptor & aa) const noexcept
+{
+    if (this->schema == nullptr)
+        return nullptr;
+
+    const auto it = this->schema->slots.find(&aa);
+    if (it == this->schema->slots.end() || this->last[it->second] == no_occurrence)
+        return nullptr;
+
+    return &this->occurrence_list[this->last[it->second]];
 }
 
+bool ParseResult::has(const ArgumentAcceptor & aa) const noexcept
+{
+    if (this->schema == nullptr)
+        return false;
+
+    const auto it = this->schema->slots.find(&aa);
+    if (it == this->schema->slots.end())
+        return false;
+
+    const auto slot = it->second;
+    return this->present[slot / 64] & (std::uint64_t(1) << (slot % 64));
+}
 
-std::ostream & ArgumentParser::print_help(std::ostream & out) const noexcept
+std::string ParseResult::error() const
 {
-    out << "Usage: " << this->prog_name << ' ';
-    for (ArgumentAcceptor * acceptor: this->acceptors)
+    if (_is_thrown(this->parse_status.code))
+        return ArgumentParseError(this->value_error).what(); // what() caches in the error
+    if (this->arg_vec == nullptr && !this->cmdline.empty())
     {
-        acceptor->print_useage(out);
-        out << ' ';
+        const auto args = _split_cmdline(this->cmdline);
+        return this->parse_status.message(args);
     }
-    out << '\n' << '\n';
+    return this->parse_status.message(this->args());
+}
 
-    out << "Options:\n";
-    for (ArgumentAcceptor * acceptor: this->acceptors)
-        acceptor->print_helpinfo(out);
+void ParseResult::reset(const ArgumentSchema & schema)
+{
+    this->clear();
+    this->schema = &schema;
+    this->state = schema.initial_state;
+    this->last.assign(schema.acceptors.size(), no_occurrence);
+    this->present.assign((schema.acceptors.size() + 63) / 64, 0);
+}
 
-    return out;
+void ParseResult::clear() noexcept
+{
+    this->schema = nullptr;
+    this->occurrence_list.clear();
+    this->state.clear();
+    this->last.clear();
+    this->present.clear();
+    this->response_files.clear();
+    this->expanded_args.clear();
+    this->expanded_sources.clear();
+    this->config.close();
+    this->command = {};
+    this->n_args = 0;
+    this->arg_vec = nullptr;
+    this->cmdline = {};
+    this->prog = {};
+    this->special_acceptor = nullptr;
+    this->parse_status = {};
+    this->value_error = {};
+    if (this->missing_names)
+        this->missing_names->clear();
 }
@@ -0,0 +1,184 @@
+#include "profile.h"
+
+#ifdef HGL_AP_INSTRUMENT
+
+#include <chrono>
+#include <fstream>
+
+using namespace hgl::ap;
+
+static thread_local ParseProfile * _current_profile = nullptr;
+
+static const char * const _phase_names[ParseProfile::n_phases] = {
+    "parse", "tokenize", "match", "convert", "required", "format",
+};
+
+static std::uint64_t _now_ns() noexcept
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/// write a JSON string literal
+static void _write_json_string(std::ostream & out, std::string_view text)
+{
+    out << '"';
+    for (const char ch: text)
+    {
+        if (ch == '"' || ch == '\\')
+            out << '\\' << ch;
+        else if (static_cast<unsigned char>(ch) < 0x20)
+            out << ' ';
+        else
+            out << ch;
+    }
+    out << '"';
+}
+
+/// write nanoseconds as microseconds, exactly and never in scientific notation
+static void _write_us(std::ostream & out, std::uint64_t ns)
+{
+    const auto frac = static_cast<unsigned>(ns % 1000);
+    const char digits[] = {'.', char('0' + frac / 100), char('0' + frac / 10 % 10), char('0' + frac % 10)};
+    out << ns / 1000;
+    out.write(digits, sizeof digits);
+}
+
+ParseProfile::ParseProfile(): origin_ns(_now_ns())
+{
+}
+
+void ParseProfile::attach(ParseProfile * profile) noexcept
+{
+    _current_profile = profile;
+}
+
+ParseProfile * ParseProfile::current() noexcept
+{
+    return _current_profile;
+}
+
+void ParseProfile::set_callback(Callback callback, void * context) noexcept
+{
+    this->callback = callback;
+    this->callback_context = context;
+}
+
+void ParseProfile::clear() noexcept
+{
+    this->origin_ns = _now_ns();
+    this->n_parses = 0;
+    for (auto & t : this->phase_time)
+        t = 0;
+    this->stats.clear();
+    this->stats_index.clear();
+    this->event_list.clear();
+    this->frames.clear();
+}
+
+const ParseProfile::Counters * ParseProfile::find(const ArgumentAcceptor & aa) const noexcept
+{
+    const auto it = this->stats_index.find(&aa);
+    return it == this->stats_index.end() ? nullptr : &this->stats[it->second].counters;
+}
+
+ParseProfile::Counters & ParseProfile::counters(const ArgumentAcceptor * aa)
+{
+    const auto [it, inserted] = this->stats_index.emplace(aa, this->stats.size());
+    if (inserted)
+    {
+        auto & s = this->stats.emplace_back();
+        s.acceptor = aa;
+        if (aa)
+            aa->get_name(s.name);
+        else
+            s.name = "(none)";
+    }
+    return this->stats[it->second].counters;
+}
+
+void ParseProfile::enter(ParsePhase phase, const ArgumentAcceptor * aa)
+{
+    const auto now = _now_ns();
+    if (!this->frames.empty())
+    {
+        const Frame & outer = this->frames.back();
+        this->phase_time[static_cast<std::size_t>(outer.phase)] += now - outer.resumed_ns;
+    }
+    this->frames.push_back({phase, aa, now, now});
+}
+
+void ParseProfile::leave()
+{
+    const auto now = _now_ns();
+    const Frame frame = this->frames.back();
+    this->frames.pop_back();
+
+    const auto self_ns = now - frame.resumed_ns;
+    this->phase_time[static_cast<std::size_t>(frame.phase)] += self_ns;
+
+    if (frame.phase == ParsePhase::convert)
+        this->counters(frame.acceptor).convert_ns += now - frame.begin_ns;
+    else if (this->event_list.size() < this->max_events)
+    {
+        this->event_list.push_back({frame.phase, static_cast<std::uint32_t>(this->frames.size()),
+            frame.begin_ns - this->origin_ns, now - frame.begin_ns});
+    }
+
+    if (!this->frames.empty())
+        this->frames.back().resumed_ns = now;
+    else if (frame.phase == ParsePhase::parse)
+    {
+        this->n_parses++;
+        if (this->callback)
+            this->callback(*this, this->callback_context);
+    }
+}
+
+bool ParseProfile::write_chrome_trace(std::ostream & out) const
+{
+    out << "{\"traceEvents\":[";
+
+    const char * sep = "\n";
+    for (const Event & e: this->event_list)
+    {
+        out << sep << "{\"name\":\"" << _phase_names[static_cast<std::size_t>(e.phase)]
+            << "\",\"cat\":\"parse\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+        _write_us(out, e.begin_ns);
+        out << ",\"dur\":";
+        _write_us(out, e.duration_ns);
+        out << '}';
+        sep = ",\n";
+    }
+
+    // counters at the end of the trace, one row per acceptor
+    const std::uint64_t end_ns = this->event_list.empty() ? 0 :
+        this->event_list.back().begin_ns + this->event_list.back().duration_ns;
+    for (const AcceptorStats & s: this->stats)
+    {
+        const Counters & c = s.counters;
+        out << sep << "{\"name\":";
+        _write_json_string(out, s.name);
+        out << ",\"cat\":\"acceptor\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":";
+        _write_us(out, end_ns);
+        out << ",\"args\":{\"lookups\":" << c.lookups << ",\"probes\":" << c.probes
+            << ",\"calls\":" << c.calls << ",\"conversions\":" << c.conversions
+            << ",\"allocations\":" << c.allocations << ",\"convert_ns\":" << c.convert_ns << "}}";
+        sep = ",\n";
+    }
+
+    out << "\n],\"otherData\":{\"parses\":\"" << this->n_parses << '"';
+    for (std::size_t i = 0; i < n_phases; i++)
+        out << ",\"" << _phase_names[i] << "_ns\":\"" << this->phase_time[i] << '"';
+    out << "}}\n";
+
+    return bool(out);
+}
+
+bool ParseProfile::write_chrome_trace(const char * path) const
+{
+    std::ofstream out(path);
+    return out && this->write_chrome_trace(out) && out.flush();
+}
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file profile.h
+ * @brief instrumentation hooks of the parser, which compile to nothing
+ *  unless HGL_AP_INSTRUMENT is defined
+ */
+
+#pragma once
+
+#include <argparse.h>
+
+#ifdef HGL_AP_INSTRUMENT
+
+namespace hgl::ap
+{
+    /// times a phase in the profile of the thread, until left or destroyed;
+    /// also counts events for ParseProfile
+    class _ProfileScope
+    {
+    private:
+        ParseProfile * profile;
+
+    public:
+        _ProfileScope(ParsePhase phase, const ArgumentAcceptor * aa):
+            profile(ParseProfile::current())
+        {
+            if (this->profile)
+                this->profile->enter(phase, aa);
+        }
+
+        _ProfileScope(const _ProfileScope &) = delete;
+        ~_ProfileScope() { this->leave(); }
+
+        void leave()
+        {
+            if (this->profile)
+                this->profile->leave();
+            this->profile = nullptr;
+        }
+
+        void switch_to(ParsePhase phase)
+        {
+            this->leave();
+            if ((this->profile = ParseProfile::current()))
+                this->profile->enter(phase, nullptr);
+        }
+
+        /// count an event of an acceptor
+        static void count(const ArgumentAcceptor * aa,
+            std::uint64_t ParseProfile::Counters::* counter)
+        {
+            ParseProfile * const profile = ParseProfile::current();
+            if (profile == nullptr)
+                return;
+
+            auto & counters = profile->counters(aa);
+            ++(counters.*counter);
+            if (counter == &ParseProfile::Counters::probes
+                    || counter == &ParseProfile::Counters::conversions)
+                ++counters.calls;
+        }
+
+        /// count an event of the acceptor of the innermost phase
+        static void count_current(std::uint64_t ParseProfile::Counters::* counter)
+        {
+            ParseProfile * const profile = ParseProfile::current();
+            if (profile && !profile->frames.empty() && profile->frames.back().acceptor)
+                ++(profile->counters(profile->frames.back().acceptor).*counter);
+        }
+    };
+}
+
+#   define HGL_AP_COUNT(aa, counter) \
+        ::hgl::ap::_ProfileScope::count(aa, &::hgl::ap::ParseProfile::Counters::counter)
+#   define HGL_AP_COUNT_CURRENT(counter) \
+        ::hgl::ap::_ProfileScope::count_current(&::hgl::ap::ParseProfile::Counters::counter)
+#   define HGL_AP_SCOPE(name, phase, aa) \
+        ::hgl::ap::_ProfileScope name(::hgl::ap::ParsePhase::phase, aa)
+#   define HGL_AP_SWITCH(name, phase) name.switch_to(::hgl::ap::ParsePhase::phase)
+#   define HGL_AP_LEAVE(name) name.leave()
+
+#else
+
+#   define HGL_AP_COUNT(aa, counter) ((void)0)
+#   define HGL_AP_COUNT_CURRENT(counter) ((void)0)
+#   define HGL_AP_SCOPE(name, phase, aa) ((void)0)
+#   define HGL_AP_SWITCH(name, phase) ((void)0)
+#   define HGL_AP_LEAVE(name) ((void)0)
+
+#endif
@@ -0,0 +1,1076 @@
+#include <argparse.h>
+#include <static_argparse.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+using namespace hgl::ap;
+
+static int failures = 0;
+
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #expr "\n"; \
+            ++failures; \
+        } \
+    } while (0)
+
+template <typename... Args>
+static bool parse(ArgumentParser & parser, Args... args)
+{
+    const char * argv[] = {"prog", args...};
+    try
+    {
+        parser(sizeof...(Args) + 1, argv);
+        return true;
+    }
+    catch (const ArgumentParseError & e)
+    {
+        return false;
+    }
+}
+
+static void test_index()
+{
+    std::vector<std::string> names;
+    std::vector<IntOption> options;
+    names.reserve(500);
+    options.reserve(500);
+    for (int i = 0; i < 500; i++)
+    {
+        names.push_back("opt-" + std::to_string(i));
+        options.emplace_back(IntOption::no_short_option, names.back(), false);
+    }
+
+    FlagOption o_flag('f', "flag", false);
+    StringOption o_str('s', "str", false);
+    TextArg a_text("text", false);
+
+    std::vector<ArgumentAcceptor *> acceptors;
+    for (auto & o : options)
+        acceptors.push_back(&o);
+    acceptors.push_back(&o_flag);
+    acceptors.push_back(&o_str);
+    acceptors.push_back(&a_text);
+
+    ArgumentParser parser(acceptors.data(), acceptors.data() + acceptors.size());
+
+    CHECK(parse(parser, "--opt-499", "7", "--opt-0=3", "-s", "x", "--no-flag", "rest"));
+    CHECK(options[499].value == 7);
+    CHECK(options[0].value == 3);
+    CHECK(o_str.value == "x");
+    CHECK(!o_flag.value());
+    CHECK(a_text.text == "rest");
+
+    CHECK(!parse(parser, "--opt-500", "1"));
+    CHECK(!parse(parser, "--no-str", "1"));
+}
+
+static void test_short_cluster()
+{
+    FlagOption o_verbose('v', "verbose", false);
+    FlagOption o_extra('x', "extra", false);
+    StringOption o_str('s', "str", false);
+    IntOption o_int('i', "int", false);
+
+    ArgumentParser parser({&o_verbose, &o_extra, &o_str, &o_int});
+
+    CHECK(parse(parser, "-vvx", "-vsVALUE", "-i5"));
+    CHECK(o_verbose.value());
+    CHECK(o_extra.value());
+    CHECK(o_str.value == "VALUE");
+    CHECK(o_int.value == 5);
+
+    StringOption o_str2('s', "str", false);
+    ArgumentParser parser2({&o_verbose, &o_str2});
+    CHECK(parse(parser2, "-vs", "VAL"));
+    CHECK(o_str2.value == "VAL");
+
+    ArgumentParser parser3({&o_verbose});
+    CHECK(!parse(parser3, "-vq"));
+}
+
+static void test_response_file()
+{
+    const std::string dir = P_tmpdir;
+    const std::string inner = dir + "/hgargparse-test-inner.rsp";
+    const std::string outer = dir + "/hgargparse-test-outer.rsp";
+
+    std::ofstream(inner) << "--str 'quoted value' \"a\\\"b\" -v";
+    std::ofstream(outer) << "  --int=42\n@" << inner << "\n\tlast\\ arg";
+
+    FlagOption o_verbose('v', "verbose", false);
+    IntOption o_int('i', "int", false);
+    StringOption o_str('s', "str", false);
+    TextArg a_first("first", false);
+    TextArg a_second("second", false);
+
+    ArgumentParser parser({&o_verbose, &o_int, &o_str, &a_first, &a_second});
+    parser.enable_response_files();
+
+    const std::string outer_arg = '@' + outer;
+    CHECK(parse(parser, outer_arg.c_str()));
+    CHECK(o_int.value == 42);
+    CHECK(o_str.value == "quoted value");
+    CHECK(a_first.text == "a\"b");
+    CHECK(o_verbose.value());
+    CHECK(a_second.text == "last arg");
+
+    std::remove(inner.c_str());
+    std::remove(outer.c_str());
+
+    ArgumentParser parser2({&o_verbose});
+    parser2.enable_response_files();
+    CHECK(!parse(parser2, "@/nonexistent/file.rsp"));
+    const char * argv_missing[] = {"prog", "@/nonexistent/file.rsp"};
+    ParseResult missing;
+    static_cast<const ArgumentSchema &>(parser2).parse(2, argv_missing, missing);
+    CHECK(missing.error().rfind("\"@/nonexistent/file.rsp\": cannot read response file: ", 0) == 0);
+
+    // a pipe cannot be mapped, and is read instead
+    const std::string fifo = dir + "/hgargparse-test.fifo";
+    std::remove(fifo.c_str());
+    CHECK(::mkfifo(fifo.c_str(), 0600) == 0);
+    std::thread writer([&fifo] { std::ofstream(fifo) << std::string(40000, ' ') << "--int=7 -v"; });
+    CHECK(parse(parser, ('@' + fifo).c_str()));
+    writer.join();
+    std::remove(fifo.c_str());
+    CHECK(o_int.value == 7 && o_verbose.value());
+
+    std::ofstream(inner) << "--str 'unclosed";
+    const std::string inner_arg = '@' + inner;
+    const char * argv[] = {"prog", inner_arg.c_str()};
+    ParseResult result;
+    CHECK(static_cast<const ArgumentSchema &>(parser).parse(2, argv, result).code
+        == ParseErrorCode::unclosed_quote);
+    CHECK(result.error() == "\"@" + inner + "\": quote not closed");
+    std::remove(inner.c_str());
+}
+
+static void test_batch()
+{
+    SpecialOption o_help('h', "help");
+    FlagOption o_verbose('v', "verbose", false);
+    IntOption o_int('i', "int", true);
+    TextArg a_text("text", false);
+
+    const ArgumentSchema schema({&o_help, &o_verbose, &o_int, &a_text});
+
+    std::vector<std::vector<std::string>> lines;
+    for (int i = 0; i < 1000; i++)
+    {
+        switch (i % 5)
+        {
+        case 0: lines.push_back({"prog", "-i", std::to_string(i)}); break;
+        case 1: lines.push_back({"prog", "-vi" + std::to_string(i), "text"}); break;
+        case 2: lines.push_back({"prog", "--verbose"}); break; // missing -i
+        case 3: lines.push_back({"prog", "-h"}); break;
+        case 4: lines.push_back({"prog", "--int=" + std::to_string(i) + "x"}); break;
+        }
+    }
+
+    std::vector<std::vector<const char *>> argv_storage;
+    std::vector<ArgVector> argvs;
+    argv_storage.reserve(lines.size());
+    for (auto & line : lines)
+    {
+        auto & argv = argv_storage.emplace_back();
+        for (auto & arg : line)
+            argv.push_back(arg.c_str());
+        argvs.push_back({static_cast<int>(argv.size()), argv.data()});
+    }
+
+    const auto results = schema.parse_batch(argvs, 4);
+    CHECK(results.size() == argvs.size());
+
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const auto & r = results[i];
+        switch (i % 5)
+        {
+        case 0:
+            CHECK(r.ok() && r.value(o_int) == long(i));
+            CHECK(!r.has(o_verbose) && !r.has(a_text));
+            break;
+        case 1:
+            CHECK(r.ok() && r.value(o_verbose) && r.value(a_text) == "text");
+            CHECK(r.value(o_int) == long(i));
+            break;
+        case 2:
+            CHECK(!r.ok());
+            break;
+        case 3:
+            CHECK(r.ok() && r.special() == &o_help);
+            break;
+        case 4:
+            CHECK(r.status().code == ParseErrorCode::bad_value && r.status().acceptor == &o_int);
+            break;
+        }
+    }
+}
+
+static void test_reuse()
+{
+    FlagOption o_flag('f', "flag", false);
+    IntOption o_int('i', "int", true);
+    StringOption o_str('s', "str", false);
+
+    ArgumentParser parser({&o_flag, &o_int, &o_str});
+
+    CHECK(parse(parser, "-i", "1", "--no-flag"));
+    CHECK(o_int.value == 1 && !o_flag.value());
+    CHECK(parse(parser, "-i", "2", "-s", "x"));
+    CHECK(o_int.value == 2 && o_str.value == "x");
+    CHECK(!parse(parser, "-s", "x"));
+
+    // values of options not given again are the defaults, not those of the last parse
+    FlagOption o_given('g', "given", false);
+    IntOption o_num('n', "num", false);
+    TextArg a_text("text", false);
+    o_num.value = 7;
+    ArgumentParser parser2({&o_given, &o_num, &a_text});
+    CHECK(parse(parser2, "--given", "-n", "1", "file"));
+    CHECK(o_given.value() && o_num.value == 1 && a_text.text == "file");
+    CHECK(parse(parser2));
+    CHECK(!o_given.value() && o_num.value == 7 && a_text.text.empty());
+
+    // the schema does not read what the last parse left in the acceptors
+    ParseResult result;
+    CHECK(parse(parser2, "file"));
+    const char * argv_text[] = {"prog", "file"};
+    CHECK(static_cast<const ArgumentSchema &>(parser2).parse(2, argv_text, result).ok());
+    CHECK(result.find(a_text)->value == "file");
+
+    const char * argv[] = {"prog", "--int=3", "--no-flag"};
+    for (int i = 0; i < 3; i++)
+    {
+        parser.parse(3, argv, result);
+        CHECK(result.ok());
+        CHECK(result.value(o_int) == 3);
+        CHECK(!result.value(o_flag, true));
+        CHECK(result.value(o_str, "none") == "none");
+        CHECK(result.find(o_int)->token == 1);
+        CHECK(result.find(o_int)->source == ArgSource::command_line);
+    }
+}
+
+static void test_status()
+{
+    SpecialOption o_help('h', "help");
+    FlagOption o_flag('f', "flag", false);
+    IntOption o_int('i', "int", true);
+    StringOption o_str('s', "str", true);
+
+    const ArgumentSchema schema({&o_help, &o_flag, &o_int, &o_str});
+    ParseResult result;
+
+    const char * argv1[] = {"prog", "-i", "1", "--bad"};
+    auto status = schema.parse(4, argv1, result);
+    CHECK(!status.ok() && status.code == ParseErrorCode::unknown_option);
+    CHECK(status.token == 3 && status.text == "bad");
+    CHECK(result.error() == "\"--bad\": unknown option: bad");
+
+    const char * argv2[] = {"prog", "-f", "--flag=1"};
+    status = schema.parse(3, argv2, result);
+    CHECK(status.code == ParseErrorCode::unexpected_value);
+    CHECK(status.token == 2 && status.acceptor == &o_flag);
+
+    const char * argv3[] = {"prog", "-f"};
+    status = schema.parse(2, argv3, result);
+    CHECK(status.code == ParseErrorCode::missing_required && status.acceptor == &o_int);
+    CHECK(result.status().code == status.code);
+    CHECK(status.detail == 2 && result.error() == "no enough arguments for INT, STR");
+
+    const char * argv5[] = {"prog", "-i", "1", "--int=2"};
+    status = schema.parse(4, argv5, result);
+    CHECK(status.code == ParseErrorCode::duplicated_option && status.token == 3);
+
+    const char * argv4[] = {"prog", "-h", "--bad"};
+    status = schema.parse(3, argv4, result);
+    CHECK(status.ok() && status.code == ParseErrorCode::special && status.acceptor == &o_help);
+
+    // values are converted, not only recorded
+    const char * argv6[] = {"prog", "-f", "--int=abc", "-s", "x"};
+    status = schema.parse(5, argv6, result);
+    CHECK(status.code == ParseErrorCode::bad_value && status.token == 2 && status.acceptor == &o_int);
+    CHECK(result.error() == "not a valid int literal: abc");
+
+    // ArgumentParser reports the same without throwing, and stops at a special option
+    ArgumentParser parser({&o_help, &o_flag, &o_int, &o_str});
+    status = parser.try_parse(5, argv6);
+    CHECK(status.code == ParseErrorCode::bad_value && status.token == 2 && status.acceptor == &o_int);
+    status = parser.try_parse(3, argv4);
+    CHECK(status.code == ParseErrorCode::special && status.token == 2 && status.acceptor == &o_help);
+
+    try
+    {
+        parser(5, argv6);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.status().token == 2 && std::string(e.what()) == "not a valid int literal: abc");
+    }
+    try
+    {
+        parser(3, argv4);
+        CHECK(false);
+    }
+    catch (SpecialOption * special)
+    {
+        CHECK(special == &o_help);
+    }
+}
+
+static void test_number()
+{
+    CHECK(Int8Option::from_text("-128") == -128);
+    CHECK(Int8Option::from_text("0x7f") == 127);
+    CHECK(UInt8Option::from_text("255") == 255);
+    CHECK(Int16Option::from_text("-0x8000") == -32768);
+    CHECK(UInt32Option::from_text("0777") == 0777);
+    CHECK(Int64Option::from_text("-9223372036854775808") == INT64_MIN);
+    CHECK(UInt64Option::from_text("+18446744073709551615") == UINT64_MAX);
+    CHECK(NumberOption<float>::from_text("-1.5e3") == -1500.0f);
+    CHECK(FloatOption::from_text("0x1p4") == 16.0);
+
+    for (const char * bad: {"128", "-129", "", "-", "1x", "0x", "08", "--1", " 1"})
+    {
+        bool thrown = false;
+        try { Int8Option::from_text(bad); } catch (const ArgumentParseError &) { thrown = true; }
+        CHECK(thrown);
+    }
+    for (const char * bad: {"-1", "256"})
+    {
+        bool thrown = false;
+        try { UInt8Option::from_text(bad); } catch (const ArgumentParseError &) { thrown = true; }
+        CHECK(thrown);
+    }
+    for (const char * bad: {"1e999", "1.0f", "+-1", "."})
+    {
+        bool thrown = false;
+        try { FloatOption::from_text(bad); } catch (const ArgumentParseError &) { thrown = true; }
+        CHECK(thrown);
+    }
+
+    // views need not be NUL-terminated
+    CHECK(IntOption::from_text(std::string_view("12345", 2)) == 12);
+
+    UInt16Option o_port('p', "port", true);
+    ArgumentParser parser({&o_port});
+    CHECK(parse(parser, "--port=8080"));
+    CHECK(o_port.value == 8080);
+    CHECK(!parse(parser, "-p", "65536"));
+}
+
+enum class Codec { h264, h265, vp9, av1 };
+
+static constexpr auto codecs = make_choices<Codec>({
+    {"h264", Codec::h264}, {"avc", Codec::h264}, {"h265", Codec::h265}, {"hevc", Codec::h265},
+    {"vp9", Codec::vp9}, {"av1", Codec::av1},
+});
+
+static_assert(codecs.find("hevc")->value == Codec::h265 && !codecs.find("h266"));
+
+static void test_enum()
+{
+    EnumOption<Codec> o_codec('c', "codec", false, codecs);
+    BoolOption o_color(BoolOption::no_short_option, "color", false);
+
+    ArgumentParser parser({&o_codec, &o_color});
+    CHECK(parse(parser, "--codec=avc", "--color=off"));
+    CHECK(o_codec.value == Codec::h264 && !o_color.value());
+    CHECK(parse(parser, "-c", "av1", "--color="));
+    CHECK(o_codec.value == Codec::av1 && o_color.value());
+
+    try
+    {
+        const char * argv[] = {"prog", "-c", "mp3"};
+        parser(3, argv);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(std::string(e.what()) == "not a valid choice: mp3 (expected h264, avc, h265, hevc, vp9, av1)");
+    }
+    CHECK(!parse(parser, "--color=maybe"));
+
+    const ArgumentSchema & schema = parser;
+    const char * argv[] = {"prog", "--codec", "vp9"};
+    CHECK(schema.parse(3, argv).value(o_codec) == Codec::vp9);
+}
+
+static void test_list()
+{
+    MultiStringOption o_include('I', "include");
+    ListOption<int> o_level('l', "level", true, nullptr, ',');
+    FlagOption o_flag('f', "flag", false);
+
+    ArgumentParser parser({&o_include, &o_level, &o_flag});
+
+    std::vector<std::string> paths;
+    std::vector<const char *> argv = {"prog", "-l1,2", "--level=3"};
+    for (int i = 0; i < 5000; i++)
+        paths.push_back("/usr/include/" + std::to_string(i));
+    for (auto & path : paths)
+    {
+        argv.push_back("-I");
+        argv.push_back(path.c_str());
+    }
+
+    for (int round = 0; round < 2; round++)
+    {
+        parser(static_cast<int>(argv.size()), argv.data());
+        CHECK(o_include.values().size() == paths.size());
+        CHECK(o_include.values()[4999] == paths[4999]);
+        CHECK(o_level.values().size() == 3 && o_level.values()[2] == 3);
+    }
+
+    CHECK(!parse(parser, "-I", "x")); // level is required
+    CHECK(!parse(parser, "-l", "1,x"));
+
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    const char * argv2[] = {"prog", "-l", "4,5", "-If", "--flag"};
+    CHECK(schema.parse(5, argv2, result).ok());
+    CHECK((o_level.decode_all(result) == std::vector<int>{4, 5}));
+    CHECK((o_include.decode_all(result) == std::vector<std::string_view>{"f"}));
+}
+
+static void test_numeric_list()
+{
+    NumericListOption<std::uint16_t> o_ports('p', "ports");
+    NumericListOption<long> o_ids(NumericListOption<long>::no_short_option, "ids");
+    NumericListOption<double> o_weights('w', "weights");
+
+    ArgumentParser parser({&o_ports, &o_ids, &o_weights});
+
+    std::string weights, ids;
+    for (int i = 0; i < 20000; i++)
+    {
+        weights += (i ? "," : "") + std::to_string(i) + ".5";
+        ids += (i ? "," : "") + std::to_string(i * 1234567891L - 9999999999L);
+    }
+
+    CHECK(parse(parser, "--ports=8000-8003,9000", "-p", "22,3-1", ("--weights=" + weights).c_str(),
+        ("--ids=" + ids).c_str(), "--ids=-5--3,0x10,010"));
+    CHECK((std::vector<std::uint16_t>(o_ports.values().begin(), o_ports.values().end())
+        == std::vector<std::uint16_t>{8000, 8001, 8002, 8003, 9000, 22, 3, 2, 1}));
+    CHECK(o_weights.values().size() == 20000 && o_weights.values()[19999] == 19999.5);
+    CHECK(o_ids.values().size() == 20005 && o_ids.values()[19999] == 19999 * 1234567891L - 9999999999L);
+    CHECK(o_ids.values()[20000] == -5 && o_ids.values()[20002] == -3);
+    CHECK(o_ids.values()[20003] == 16 && o_ids.values()[20004] == 8);
+
+    // a range that is the only item must not run into the next buffer taken from the arena
+    CHECK(parse(parser, "--ids=1-3", "-w", "99"));
+    CHECK((std::vector<long>(o_ids.values().begin(), o_ids.values().end()) == std::vector<long>{1, 2, 3}));
+    CHECK(o_weights.values().size() == 1 && o_weights.values()[0] == 99);
+
+    CHECK(!parse(parser, "-p", "65536"));
+    CHECK(!parse(parser, "-p", "1-x"));
+    CHECK(!parse(parser, "--ids=0-100000000"));
+    CHECK(!parse(parser, "-w", "1-2"));
+
+    const ArgumentSchema & schema = parser;
+    const char * argv[] = {"prog", "-p1-3", "-p", "12345"};
+    CHECK((o_ports.decode_all(schema.parse(4, argv)) == std::vector<std::uint16_t>{1, 2, 3, 12345}));
+}
+
+static void test_help()
+{
+    FlagOption o_flag('f', "flag", false, "a flag");
+    IntOption o_int(IntOption::no_short_option, "int", true, "an int");
+    TextArg a_text("text", false);
+
+    ArgumentParser parser({&o_flag, &o_int, &a_text});
+    CHECK(parse(parser, "--int", "1"));
+
+    const auto text = parser.help_text();
+    CHECK(text ==
+        "Usage: prog [-f] --int INT [text] \n\n"
+        "Options:\n"
+        "-f, --flag  a flag\n"
+        "--int INT   an int\n");
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++)
+        threads.emplace_back([&] { CHECK(parser.help_text().data() == text.data()); });
+    for (auto & t : threads)
+        t.join();
+
+    char buffer[8];
+    CHECK(parser.copy_help(buffer, sizeof buffer) == text.size());
+    CHECK(std::string_view(buffer) == "Usage: ");
+
+    ArgumentAcceptor * const only_flag[] = {&o_flag};
+    parser.set_acceptors(only_flag, only_flag + 1);
+    CHECK(parser.help_text() == "Usage: prog [-f] \n\nOptions:\n-f, --flag  a flag\n");
+}
+
+static void test_env()
+{
+    IntOption o_port('p', "port", true);
+    StringOption o_host(StringOption::no_short_option, "host-name", false);
+    FlagOption o_verbose('v', "verbose", false);
+    FlagOption o_quiet('q', "quiet", false);
+    o_port.set_env();
+    o_host.set_env();
+    o_verbose.set_env("VERBOSE");
+    o_quiet.set_env("QUIET");
+
+    ArgumentParser parser({&o_port, &o_host, &o_verbose, &o_quiet});
+    parser.set_env_prefix("HGAP_TEST_");
+
+    setenv("HGAP_TEST_PORT", "8080", 1);
+    setenv("HGAP_TEST_HOST_NAME", "localhost", 1);
+    setenv("VERBOSE", "1", 1);
+    setenv("QUIET", "0", 1);
+
+    o_quiet.value(false);
+    CHECK(parse(parser, "--port", "80"));
+    CHECK(o_port.value == 80);
+    CHECK(o_host.value == "localhost");
+    CHECK(o_verbose.value() && !o_quiet.value());
+
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    const char * argv[] = {"prog"};
+    CHECK(schema.parse(1, argv, result).ok());
+    CHECK(result.value(o_port) == 8080);
+    CHECK(result.find(o_port)->source == ArgSource::environment);
+    CHECK(!result.has(o_quiet));
+
+    unsetenv("HGAP_TEST_PORT");
+    CHECK(!schema.parse(1, argv, result).ok()); // port is required
+
+    unsetenv("HGAP_TEST_HOST_NAME");
+    unsetenv("VERBOSE");
+    unsetenv("QUIET");
+}
+
+static void test_config()
+{
+    const std::string path = std::string(P_tmpdir) + "/hgargparse-test.conf";
+    std::ofstream(path) <<
+        "# comment\n"
+        "port = 80\n"
+        "verbose = yes\n"
+        "port=8080\r\n"
+        "name = \"quoted value\"\n"
+        "\n"
+        "[server]\n"
+        "  host = example.com  \n"
+        "; trailing comment";
+
+    IntOption o_port('p', "port", true);
+    FlagOption o_verbose('v', "verbose", false);
+    StringOption o_name('n', "name", false);
+    StringOption o_host(StringOption::no_short_option, "server-host", false);
+    o_name.set_env("HGAP_TEST_NAME");
+
+    ArgumentParser parser({&o_port, &o_verbose, &o_name, &o_host});
+    parser.set_config_file(path);
+
+    setenv("HGAP_TEST_NAME", "from-env", 1);
+    o_verbose.value(false);
+    CHECK(parse(parser));
+    CHECK(o_port.value == 8080);
+    CHECK(o_verbose.value());
+    CHECK(o_name.value == "from-env");
+    CHECK(o_host.value == "example.com");
+    unsetenv("HGAP_TEST_NAME");
+
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    const char * argv[] = {"prog", "-p", "1"};
+    CHECK(schema.parse(3, argv, result).ok());
+    CHECK(result.value(o_port) == 1);
+    CHECK(result.value(o_name) == "quoted value");
+    CHECK(result.find(o_host)->source == ArgSource::config_file);
+    CHECK(result.value(o_host).data()[result.value(o_host).size()] == '\0');
+
+    // a repeated key keeps the last line, for lists too
+    std::ofstream(path) << "tag = a,b\nverbose = yes\ntag = c\nverbose = no\n";
+    MultiStringOption o_tag('t', "tag", false, nullptr, ',');
+    ArgumentParser parser2({&o_verbose, &o_tag});
+    parser2.set_config_file(path);
+    CHECK(parse(parser2));
+    CHECK(o_tag.values().size() == 1 && o_tag.values()[0] == "c" && !o_verbose.value());
+    const ArgumentSchema & schema2 = parser2;
+    CHECK(schema2.parse(1, argv, result).ok());
+    CHECK(o_tag.decode_all(result) == std::vector<std::string_view>{"c"} && !result.has(o_verbose));
+    CHECK(parse(parser2, "-t", "x"));
+    CHECK(o_tag.values().size() == 1 && o_tag.values()[0] == "x");
+
+    std::ofstream(path) << "port = 1\nbogus = 2\n";
+    CHECK(schema.parse(1, argv, result).code == ParseErrorCode::unknown_config_key);
+    CHECK(result.status().detail == 2);
+
+    std::remove(path.c_str());
+    CHECK(schema.parse(1, argv, result).code == ParseErrorCode::bad_config_file);
+    parser.set_config_file(path, false);
+    CHECK(schema.parse(3, argv, result).ok());
+}
+
+static int build_parsers = 0;
+
+struct BuildCommand: ArgumentParser
+{
+    IntOption o_jobs{'j', "jobs", false};
+    TextArg a_target{"target", true};
+
+    BuildCommand()
+    {
+        ArgumentAcceptor * const acceptors[] = {&o_jobs, &a_target};
+        this->set_acceptors(acceptors, acceptors + 2);
+        build_parsers++;
+    }
+};
+
+struct PushCommand: ArgumentParser
+{
+    FlagOption o_force{'f', "force", false};
+
+    PushCommand()
+    {
+        ArgumentAcceptor * const acceptors[] = {&o_force};
+        this->set_acceptors(acceptors, acceptors + 1);
+    }
+};
+
+struct BrokenCommand: ArgumentParser
+{
+    BrokenCommand() { throw std::runtime_error("cannot set up"); }
+};
+
+static void test_subcommand()
+{
+    FlagOption o_verbose('v', "verbose", false);
+
+    ArgumentParser parser({&o_verbose});
+    parser.add_subcommand<PushCommand>("push", "push changes");
+    parser.add_subcommand<BuildCommand>("build", "build a target");
+
+    CHECK(parse(parser, "-v", "push", "--force"));
+    CHECK(parser.subcommand() == "push");
+    CHECK(build_parsers == 0);
+
+    CHECK(parse(parser, "build", "-j", "4", "all"));
+    CHECK(parser.subcommand() == "build");
+    auto & build = static_cast<BuildCommand &>(*parser.subcommand_parser());
+    CHECK(build.o_jobs.value == 4 && build.a_target.text == "all");
+
+    CHECK(!parse(parser, "clean"));
+    CHECK(!parse(parser, "build", "-v", "all")); // -v belongs to the main parser
+
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    const char * argv[] = {"prog", "-v", "build", "--jobs=2"};
+    auto status = schema.parse(4, argv, result);
+    CHECK(status.code == ParseErrorCode::missing_required && status.token == 4);
+    const char * argv2[] = {"prog", "build", "--jobs=2", "x"};
+    CHECK(schema.parse(4, argv2, result).ok());
+    CHECK(result.subcommand() == "build");
+    CHECK(result.subcommand_result()->value(build.o_jobs) == 2);
+    CHECK(build_parsers == 1);
+
+    // a bad value in the subcommand is located in the main arguments
+    const char * argv_bad[] = {"prog", "-v", "build", "--jobs=x", "all"};
+    status = schema.parse(5, argv_bad, result);
+    CHECK(status.code == ParseErrorCode::bad_value && status.token == 3);
+    CHECK(result.error() == "not a valid int literal: x");
+    CHECK(parser.try_parse(5, argv_bad).token == 3);
+
+    const auto help = parser.help_text();
+    CHECK(help.find("Commands:\nbuild  build a target\npush   push changes\n") != help.npos);
+
+    ArgumentParser parser2({&o_verbose});
+    parser2.add_subcommand<BuildCommand>("build", "build a target");
+    parser2.add_subcommand<BrokenCommand>("broken", "cannot be created");
+    parser2.enable_response_files();
+
+    const char * argv3[] = {"prog", "-v", "broken"};
+    CHECK(static_cast<const ArgumentSchema &>(parser2).parse(3, argv3, result).code
+        == ParseErrorCode::bad_subcommand);
+    CHECK(result.error() == "\"broken\": cannot set up command");
+
+    // tokens of the subcommand keep the sources given by the main parser
+    const std::string path = std::string(P_tmpdir) + "/hgargparse-test-sub.rsp";
+    std::ofstream(path) << "build --jobs=3 x";
+    const std::string path_arg = '@' + path;
+    const char * argv4[] = {"prog", path_arg.c_str()};
+    CHECK(static_cast<const ArgumentSchema &>(parser2).parse(2, argv4, result).ok());
+    const auto & occurrences = result.subcommand_result()->occurrences();
+    CHECK(occurrences.size() == 2 && occurrences[0].source == ArgSource::response_file);
+    std::remove(path.c_str());
+}
+
+static void test_lazy()
+{
+    LazyOption<IntOption> o_int('i', "int", false);
+    LazyOption<BoolOption> o_bool('b', "bool", false);
+    LazyOption<FloatOption> o_float('f', "float", false);
+
+    ArgumentParser parser({&o_int, &o_bool, &o_float});
+
+    CHECK(parse(parser, "-i", "0x10", "-b", "bad"));
+    CHECK(o_int.present() && o_int.text() == "0x10");
+    CHECK(o_int.value() == 16);
+    CHECK(!o_float.present() && o_float.value(1.5) == 1.5);
+
+    bool thrown = false;
+    try { parser.validate(); } catch (const ArgumentParseError &) { thrown = true; }
+    CHECK(thrown);
+
+    CHECK(parse(parser, "-b", "yes"));
+    CHECK(!o_int.present() && o_int.value(7) == 7);
+    CHECK(o_bool.value());
+    parser.validate();
+}
+
+static void test_cmdline()
+{
+    FlagOption o_verbose('v', "verbose", false);
+    StringOption o_str('s', "str", false);
+    TextArg a_text("text", false);
+
+    ArgumentParser parser({&o_verbose, &o_str, &a_text});
+
+    const char blob[] = "/usr/bin/prog\0-v\0--str\0abc\0rest"; // ends with the implicit '\0'
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    CHECK(schema.parse_cmdline(blob, sizeof blob, result).ok());
+    CHECK(result.prog_name() == "prog" && result.args().empty());
+    CHECK(result.find(o_str)->token == 3 && result.find(o_str)->args[0] == blob + 23);
+
+    parser.parse_cmdline(blob, sizeof blob);
+    CHECK(o_verbose.value() && o_str.value == "abc" && a_text.text == "rest");
+
+    const char bad[] = "prog\0--bad\0x";
+    CHECK(schema.parse_cmdline(bad, sizeof bad, result).code == ParseErrorCode::unknown_option);
+    CHECK(result.status().token == 1 && result.error().find("\"--bad\"") != std::string::npos);
+
+    bool thrown = false;
+    try { parser.parse_cmdline(bad, sizeof bad); } catch (const ArgumentParseError &) { thrown = true; }
+    CHECK(thrown);
+}
+
+static void test_tokens()
+{
+    StringOption o_str('s', "str", false);
+    TextArg a_text("text", false);
+
+    ArgumentParser parser({&o_str, &a_text});
+
+    const ArgumentSchema & schema = parser;
+    const char * argv[] = {"prog", "-s", "", "-"};
+    const auto result = schema.parse(4, argv);
+    CHECK(result.ok() && result.find(o_str)->value.empty() && result.find(a_text)->value == "-");
+
+    // tokens measured at every alignment, across 16 byte blocks
+    const std::string value = "a=" + std::string(40, 'x') + "=b";
+    char buffer[160];
+    for (std::size_t offset = 0; offset < 16; offset++)
+    {
+        const std::string opt = "--str=" + value;
+        std::memcpy(buffer + offset, opt.c_str(), opt.size() + 1);
+        const char * const text = buffer + offset + opt.size() + 1;
+        std::memcpy(buffer + offset + opt.size() + 1, value.c_str(), value.size() + 1);
+
+        CHECK(parse(parser, buffer + offset, text));
+        CHECK(o_str.value == value && a_text.text == value);
+    }
+}
+
+static void test_complete()
+{
+    FlagOption o_verbose('v', "verbose", false);
+    BoolOption o_color('c', "color", false);
+    StringOption o_output('o', "output", false);
+
+    ArgumentParser parser({&o_verbose, &o_color, &o_output});
+    parser.add_subcommand<PushCommand>("push", "push changes");
+    parser.add_subcommand<BuildCommand>("build", "build a target");
+
+    auto complete = [&parser] (auto... words) {
+        const char * argv[] = {"prog", "--__complete", words...};
+        std::ostringstream out;
+        CHECK(parser.complete(sizeof...(words) + 2, argv, out));
+        return out.str();
+    };
+
+    CHECK(complete("--v") == "--verbose\n");
+    CHECK(complete("--no") == "--no-verbose\n");
+    CHECK(complete("--") == "--color\n--no-verbose\n--output\n--verbose\n"); // in name order
+    CHECK(complete("--color", "y") == "yes\n");
+    CHECK(complete("-c", "o") == "on\noff\n");
+    CHECK(complete("-o", "x", "b") == "build\n");
+    CHECK(complete("") == "build\npush\n");
+    CHECK(complete("-o", "") == ""); // argument of --output
+    CHECK(complete("build", "--j") == "--jobs\n");
+    CHECK(complete("push", "-") == "-f\n--force\n--no-force\n");
+
+    const char * argv[] = {"prog", "-v"};
+    std::ostringstream out;
+    CHECK(!parser.complete(2, argv, out) && out.str().empty());
+
+    ArgumentSchema::print_completion_script(out, CompletionShell::bash, "my-prog");
+    CHECK(out.str().find("complete -o default -F _my_prog_complete my-prog\n") != std::string::npos);
+}
+
+static void test_abbreviation()
+{
+    FlagOption o_verbose('v', "verbose", false);
+    FlagOption o_version(FlagOption::no_short_option, "version", false);
+    StringOption o_out('o', "output", false);
+    StringOption o_outdir(StringOption::no_short_option, "out", false);
+
+    ArgumentParser parser({&o_verbose, &o_version, &o_out, &o_outdir});
+    CHECK(!parse(parser, "--verb"));
+
+    parser.enable_abbreviations();
+    CHECK(parse(parser, "--verb", "--outp=x", "--out", "y"));
+    CHECK(o_verbose.value() && !o_version.value());
+    CHECK(o_out.value == "x" && o_outdir.value == "y"); // an exact name wins
+    CHECK(parse(parser, "--no-verb"));
+    CHECK(!o_verbose.value());
+
+    const ArgumentSchema & schema = parser;
+    ParseResult result;
+    const char * argv[] = {"prog", "--ver"};
+    const auto status = schema.parse(2, argv, result);
+    CHECK(status.code == ParseErrorCode::ambiguous_option && status.detail == 2);
+    CHECK(status.text == "ver" && status.acceptor == &o_verbose);
+    CHECK(!parse(parser, "--outp", "x", "--output=y")); // still accepted once
+
+    // "out" is also a prefix of "output"; given twice, it is duplicated, not ambiguous
+    const char * argv2[] = {"prog", "--out", "a", "--out", "b"};
+    CHECK(schema.parse(5, argv2, result).code == ParseErrorCode::duplicated_option);
+}
+
+/// option taking two arguments, which ArgumentParser gives to accept(int, const char **)
+struct PairOption: Option
+{
+    std::string_view first, second;
+
+    PairOption(char short_option, std::string_view long_option):
+        Option(short_option, long_option, false, 2) {}
+
+protected:
+    void accept(int, const char ** text) override
+    {
+        first = text[0], second = text[1];
+        this->mark_completed();
+    }
+};
+
+static void test_static()
+{
+    StaticArgumentParser<FlagOption, IntOption, StringOption, BoolOption, TextArg> parser(
+        FlagOption('v', "verbose", false), IntOption('n', "num", true),
+        StringOption('s', "str", false), BoolOption('b', "bool", false), TextArg("file", false));
+
+    const char * argv1[] = {"prog", "-vn0x10", "--str=x", "-b", "yes", "in.txt"};
+    parser(6, argv1);
+    CHECK(parser.get<0>().value() && parser.get<1>().value == 16);
+    CHECK(parser.get<2>().value == "x" && parser.get<3>().value());
+    CHECK(parser.get<4>().text == "in.txt");
+
+    const char * argv2[] = {"prog", "--no-verbose", "--num", "3", "--", "rest"};
+    CHECK(parser.parse(6, argv2).ok());
+    CHECK(!parser.get<0>().value() && parser.get<1>().value == 3 && parser.get<4>().text == "rest");
+
+    const char * argv3[] = {"prog", "-n", "1", "--num=2"};
+    const auto status = parser.parse(4, argv3);
+    CHECK(status.code == ParseErrorCode::duplicated_option && status.token == 3);
+    CHECK(status.message({argv3, 4}) == "\"--num=2\": duplicated option: num");
+
+    const char * argv4[] = {"prog", "-v"};
+    CHECK(parser.parse(2, argv4).code == ParseErrorCode::missing_required);
+
+    const char * argv5[] = {"prog", "-v", "--num=x"};
+    try
+    {
+        parser(3, argv5);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.status().token == 2 && e.status().acceptor == &parser.get<1>()); // as ArgumentParser
+    }
+
+    // derived types accept by themselves; values not given are restored
+    StaticArgumentParser<LazyOption<IntOption>, PairOption, IntOption, FlagOption> parser2(
+        LazyOption<IntOption>('l', "lazy", false), PairOption('p', "pair"),
+        IntOption('n', "num", false), FlagOption('v', "verbose", false));
+    parser2.get<2>().value = 5;
+
+    const char * argv6[] = {"prog", "--lazy", "0x10", "--pair", "a", "b", "-n", "1", "--verbose"};
+    CHECK(parser2.parse(9, argv6).ok());
+    CHECK(parser2.get<0>().present() && parser2.get<0>().value() == 16);
+    CHECK(parser2.get<1>().first == "a" && parser2.get<1>().second == "b");
+    CHECK(parser2.get<2>().value == 1 && parser2.get<3>().value());
+
+    const char * argv7[] = {"prog", "-p", "c", "d"};
+    CHECK(parser2.parse(4, argv7).ok());
+    CHECK(!parser2.get<0>().present() && parser2.get<1>().second == "d");
+    CHECK(parser2.get<2>().value == 5 && !parser2.get<3>().value());
+
+    const char * argv8[] = {"prog", "--pair", "a"};
+    CHECK(parser2.parse(3, argv8).code == ParseErrorCode::too_few_arguments);
+}
+
+static void test_error()
+{
+    const std::string long_name(300, 'x');
+    IntOption o_num('n', "num", false);
+    StringOption o_name('N', long_name, false);
+    EnumOption<Codec> o_codec('c', "codec", false, codecs);
+
+    ArgumentParser parser({&o_num, &o_name, &o_codec});
+
+    const std::string unknown = "--" + std::string(300, 'y');
+    const char * argv1[] = {"prog", "-n", "1", unknown.c_str()};
+    try
+    {
+        parser(4, argv1);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.code() == ParseErrorCode::unknown_option && e.status().token == 3);
+        CHECK(e.what() == '"' + unknown + "\": unknown option: " + unknown.substr(2)); // not truncated
+    }
+
+    const char * argv2[] = {"prog", "-n", "1", "--num", "x"};
+    try
+    {
+        parser(5, argv2);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.code() == ParseErrorCode::duplicated_option && e.status().token == 3);
+    }
+
+    const char * argv3[] = {"prog", "--codec", "av1", "-n", "99999999999999999999"};
+    try
+    {
+        parser(5, argv3);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.code() == ParseErrorCode::value_out_of_range && e.status().token == 4);
+        CHECK(e.status().acceptor == &o_num && e.status().text == "99999999999999999999");
+        CHECK(e.what() == std::string("int literal out of range: 99999999999999999999"));
+    }
+
+    const char * argv4[] = {"prog", "-c", "mp3"};
+    try
+    {
+        parser(3, argv4);
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.code() == ParseErrorCode::bad_choice && e.status().acceptor == &o_codec);
+        const ArgumentParseError copy = e;
+        CHECK(std::string(copy.what()) == e.what());
+    }
+
+    try
+    {
+        IntOption::from_text("1x");
+        CHECK(false);
+    }
+    catch (const ArgumentParseError & e)
+    {
+        CHECK(e.code() == ParseErrorCode::bad_value && e.status().acceptor == nullptr);
+    }
+
+    CHECK(ArgumentParseError("custom").code() == ParseErrorCode::other);
+    CHECK(ArgumentParseError("custom").what() == std::string("custom"));
+}
+
+#ifdef HGL_AP_INSTRUMENT
+static void test_profile()
+{
+    FlagOption o_flag('f', "flag", false);
+    MultiStringOption o_list('l', "list", false);
+    TextArg a_text("text", false);
+
+    ArgumentParser parser({&o_flag, &o_list, &a_text});
+
+    ParseProfile profile;
+    int callbacks = 0;
+    profile.set_callback([] (const ParseProfile &, void * n) { ++*static_cast<int *>(n); },
+        &callbacks);
+
+    ParseProfile::attach(&profile);
+    CHECK(parse(parser, "-f", "-l", "a", "-l", "b", "rest"));
+    CHECK(!parse(parser, "--bad"));
+    CHECK(profile.phase_ns(ParsePhase::format) == 0); // not formatted until asked for
+    const ArgumentParseError error(ParseStatus{ParseErrorCode::unknown_option, 0, 1, nullptr, "bad"},
+        Span<const char * const>());
+    CHECK(error.what() == std::string("\"\": unknown option: bad"));
+    ParseProfile::attach(nullptr);
+    CHECK(parse(parser, "-f"));
+
+    CHECK(profile.parses() == 2 && callbacks == 2);
+    CHECK(profile.find(o_list)->lookups == 2 && profile.find(o_list)->conversions == 2);
+    CHECK(profile.find(a_text)->probes == 2); // "rest", then "--bad" is checked for duplicates
+    CHECK(profile.phase_ns(ParsePhase::match) > 0 && profile.phase_ns(ParsePhase::format) > 0);
+
+    std::ostringstream trace;
+    CHECK(profile.write_chrome_trace(trace));
+    CHECK(trace.str().find("\"name\":\"required\"") != std::string::npos);
+    CHECK(std::regex_search(trace.str(), std::regex("\"ts\":[0-9]+\\.[0-9]{3},\"dur\":[0-9]+\\.[0-9]{3}\\}")));
+    CHECK(trace.str().find("e+") == std::string::npos);
+}
+#endif
+
+int main()
+{
+    test_index();
+    test_short_cluster();
+    test_response_file();
+    test_batch();
+    test_reuse();
+    test_status();
+    test_number();
+    test_enum();
+    test_list();
+    test_numeric_list();
+    test_help();
+    test_env();
+    test_config();
+    test_subcommand();
+    test_lazy();
+    test_cmdline();
+    test_tokens();
+    test_complete();
+    test_abbreviation();
+    test_static();
+    test_error();
+#ifdef HGL_AP_INSTRUMENT
+    test_profile();
+#endif
+
+    if (failures)
+        std::cerr << failures << " check(s) failed\n";
+    return failures ? 1 : 0;
+}